@@ -0,0 +1,101 @@
+/*
+ * benchmarks/benchmark-allocator-matmul.cpp
+ *
+ * Compare matrix multiplication throughput on tensors backed by
+ * the different TorchAllocator configurations.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+
+#include <glib-object.h>
+
+#include <torch-gobject/torch-allocator.h>
+#include <torch-gobject/torch-allocator-internal.h>
+
+#include <torch/torch.h>
+
+namespace
+{
+  constexpr int64_t kSizes[] = { 1024, 2048, 4096 };
+  constexpr int kWarmupIterations = 2;
+  constexpr int kIterations = 10;
+
+  torch::Tensor
+  new_matrix_with_allocator (TorchAllocator *allocator, int64_t size)
+  {
+    c10::Allocator &real_allocator = torch_allocator_get_real_allocator (allocator);
+    const size_t    n_bytes = size * size * sizeof (float);
+    c10::Storage    storage (c10::Storage::use_byte_size_t{}, n_bytes, &real_allocator, false);
+
+    torch::Tensor tensor = torch::empty ({0}, torch::kFloat32).set_ (storage, 0, {size, size}, {size, 1});
+    tensor.normal_ ();
+
+    return tensor;
+  }
+
+  double
+  benchmark_matmul (TorchAllocator *allocator, int64_t size)
+  {
+    torch::Tensor a = new_matrix_with_allocator (allocator, size);
+    torch::Tensor b = new_matrix_with_allocator (allocator, size);
+    torch::Tensor out = new_matrix_with_allocator (allocator, size);
+
+    for (int i = 0; i < kWarmupIterations; ++i)
+      torch::mm_out (out, a, b);
+
+    gint64 start = g_get_monotonic_time ();
+
+    for (int i = 0; i < kIterations; ++i)
+      torch::mm_out (out, a, b);
+
+    gint64 elapsed_us = g_get_monotonic_time () - start;
+    double flops = 2.0 * size * size * size * kIterations;
+
+    return flops / (elapsed_us * 1e3);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  struct {
+    const char     *name;
+    TorchAllocator *allocator;
+  } configurations[] = {
+    { "g_malloc", torch_allocator_new () },
+    { "aligned-64", torch_allocator_new_aligned (64, 0) },
+    { "aligned-64+huge-pages", torch_allocator_new_aligned (64, 2 * 1024 * 1024) }
+  };
+
+  g_print ("%-24s %8s %12s\n", "allocator", "size", "GFLOP/s");
+
+  for (int64_t size : kSizes)
+    {
+      for (auto const &configuration : configurations)
+        g_print ("%-24s %8" G_GINT64_FORMAT " %12.2f\n",
+                 configuration.name,
+                 size,
+                 benchmark_matmul (configuration.allocator, size));
+    }
+
+  for (auto const &configuration : configurations)
+    g_object_unref (configuration.allocator);
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * benchmarks/benchmark-op-overhead.cpp
+ *
+ * Measure the per-call overhead of the generated ATen wrappers
+ * against calling libtorch directly, using tensors small enough
+ * that the arithmetic itself is negligible.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+
+#include <glib-object.h>
+
+#include <torch-gobject/torch-tensor.h>
+#include <torch-gobject/torch-tensor-generated.h>
+#include <torch-gobject/torch-tensor-internal.h>
+
+#include <torch/torch.h>
+
+namespace
+{
+  constexpr int kWarmupIterations = 1000;
+  constexpr int kIterations = 100000;
+  constexpr int kCatTensors = 4;
+
+  template <typename Func>
+  double
+  nanoseconds_per_call (Func &&func)
+  {
+    for (int i = 0; i < kWarmupIterations; ++i)
+      func ();
+
+    gint64 start = g_get_monotonic_time ();
+
+    for (int i = 0; i < kIterations; ++i)
+      func ();
+
+    gint64 elapsed_us = g_get_monotonic_time () - start;
+
+    return (elapsed_us * 1e3) / kIterations;
+  }
+
+  void
+  print_result (const char *name, double ns_per_call)
+  {
+    g_print ("%-36s %12.1f\n", name, ns_per_call);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  torch::Tensor real_a = torch::ones ({4});
+  torch::Tensor real_b = torch::ones ({4});
+  torch::Tensor real_out = torch::empty ({4});
+
+  g_autoptr (TorchTensor) a = torch_tensor_new_from_real_tensor (real_a);
+  g_autoptr (TorchTensor) b = torch_tensor_new_from_real_tensor (real_b);
+  g_autoptr (TorchTensor) out = torch_tensor_new_from_real_tensor (real_out);
+
+  std::vector <torch::Tensor> real_cat_tensors (kCatTensors, real_a);
+  g_autoptr (GPtrArray) cat_tensors = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (int i = 0; i < kCatTensors; ++i)
+    g_ptr_array_add (cat_tensors, torch_tensor_new_from_real_tensor (real_a));
+
+  g_print ("%-36s %12s\n", "operation", "ns/call");
+
+  /* The cost of wrapping a result, which every generated
+   * wrapper that returns a tensor pays */
+  print_result ("torch_tensor_new_from_real_tensor", nanoseconds_per_call ([&]() {
+    g_autoptr (TorchTensor) wrapped = torch_tensor_new_from_real_tensor (real_a);
+  }));
+
+  print_result ("libtorch add", nanoseconds_per_call ([&]() {
+    torch::Tensor result = real_a.add (real_b);
+  }));
+  print_result ("torch_tensor_add_tensor_long", nanoseconds_per_call ([&]() {
+    g_autoptr (TorchTensor) result = torch_tensor_add_tensor_long (a, b, 1, NULL);
+  }));
+
+  print_result ("libtorch add_out", nanoseconds_per_call ([&]() {
+    torch::add_out (real_out, real_a, real_b);
+  }));
+  print_result ("torch_add_out_long", nanoseconds_per_call ([&]() {
+    torch_add_out_long (out, a, b, 1, NULL);
+  }));
+
+  print_result ("libtorch cat", nanoseconds_per_call ([&]() {
+    torch::Tensor result = torch::cat (real_cat_tensors, 0);
+  }));
+  print_result ("torch_cat", nanoseconds_per_call ([&]() {
+    g_autoptr (TorchTensor) result = torch_cat (cat_tensors, 0, NULL);
+  }));
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * tests/cpp/test-allocator.cpp
+ *
+ * Tests for the caching TorchAllocator.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <torch-gobject/torch-allocator.h>
+#include <torch-gobject/torch-storage.h>
+
+namespace
+{
+  struct CacheStatistics
+  {
+    guint64 hits;
+    guint64 misses;
+    guint64 retained_bytes;
+  };
+
+  CacheStatistics
+  get_statistics (TorchAllocator *allocator)
+  {
+    CacheStatistics statistics;
+
+    torch_allocator_get_cache_statistics (allocator,
+                                          &statistics.hits,
+                                          &statistics.misses,
+                                          &statistics.retained_bytes);
+    return statistics;
+  }
+
+  /* Allocates a storage of @n_bytes from @allocator and releases it
+   * straight away */
+  void
+  allocate_and_release (TorchAllocator *allocator,
+                        size_t          n_bytes)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchStorage) storage = torch_storage_new_with_allocator (n_bytes, allocator, FALSE, &error);
+
+    ASSERT_NE (storage, nullptr);
+  }
+
+  TEST (TorchAllocator, ReleasedBlockIsReusedForSameSizeClass)
+  {
+    g_autoptr (TorchAllocator) allocator = torch_allocator_new_caching (1024 * 1024);
+
+    allocate_and_release (allocator, 200);
+
+    CacheStatistics after_release = get_statistics (allocator);
+    EXPECT_EQ (after_release.hits, 0u);
+    EXPECT_EQ (after_release.misses, 1u);
+    EXPECT_EQ (after_release.retained_bytes, 256u);
+
+    /* 200 and 256 bytes are both in the 256 byte size class */
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchStorage) storage = torch_storage_new_with_allocator (256, allocator, FALSE, &error);
+
+    ASSERT_NE (storage, nullptr);
+
+    CacheStatistics after_reuse = get_statistics (allocator);
+    EXPECT_EQ (after_reuse.hits, 1u);
+    EXPECT_EQ (after_reuse.misses, 1u);
+    EXPECT_EQ (after_reuse.retained_bytes, 0u);
+  }
+
+  TEST (TorchAllocator, DifferentSizeClassIsAMiss)
+  {
+    g_autoptr (TorchAllocator) allocator = torch_allocator_new_caching (1024 * 1024);
+
+    allocate_and_release (allocator, 256);
+    allocate_and_release (allocator, 1024);
+
+    CacheStatistics statistics = get_statistics (allocator);
+    EXPECT_EQ (statistics.hits, 0u);
+    EXPECT_EQ (statistics.misses, 2u);
+    EXPECT_EQ (statistics.retained_bytes, 256u + 1024u);
+  }
+
+  TEST (TorchAllocator, TrimEmptiesFreeLists)
+  {
+    g_autoptr (TorchAllocator) allocator = torch_allocator_new_caching (1024 * 1024);
+
+    allocate_and_release (allocator, 256);
+    allocate_and_release (allocator, 1024);
+    ASSERT_EQ (get_statistics (allocator).retained_bytes, 256u + 1024u);
+
+    torch_allocator_trim (allocator);
+    EXPECT_EQ (get_statistics (allocator).retained_bytes, 0u);
+
+    /* Nothing is left to reuse */
+    allocate_and_release (allocator, 256);
+
+    CacheStatistics statistics = get_statistics (allocator);
+    EXPECT_EQ (statistics.hits, 0u);
+    EXPECT_EQ (statistics.misses, 3u);
+  }
+
+  TEST (TorchAllocator, RetainsAtMostMaxRetainedBytes)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchAllocator) allocator = torch_allocator_new_caching (256);
+    TorchStorage *first = torch_storage_new_with_allocator (256, allocator, FALSE, &error);
+    TorchStorage *second = torch_storage_new_with_allocator (256, allocator, FALSE, &error);
+
+    ASSERT_NE (first, nullptr);
+    ASSERT_NE (second, nullptr);
+
+    g_object_unref (first);
+    EXPECT_EQ (get_statistics (allocator).retained_bytes, 256u);
+
+    /* The second block would go over the bound, so it is freed */
+    g_object_unref (second);
+    EXPECT_EQ (get_statistics (allocator).retained_bytes, 256u);
+
+    /* Blocks larger than the bound are never retained */
+    allocate_and_release (allocator, 1024);
+    EXPECT_EQ (get_statistics (allocator).retained_bytes, 256u);
+  }
+
+  TEST (TorchAllocator, NonCachingAllocatorHasNoStatistics)
+  {
+    g_autoptr (TorchAllocator) allocator = torch_allocator_new ();
+
+    allocate_and_release (allocator, 256);
+
+    CacheStatistics statistics = get_statistics (allocator);
+    EXPECT_EQ (statistics.hits, 0u);
+    EXPECT_EQ (statistics.misses, 0u);
+    EXPECT_EQ (statistics.retained_bytes, 0u);
+  }
+}
@@ -0,0 +1,189 @@
+/*
+ * tests/cpp/test-nn-any-module.cpp
+ *
+ * Tests for calling forward on TorchNNAnyModule and
+ * TorchNNAnyModuleCastable.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <torch-gobject/nn/torch-nn-any-module-castable.h>
+#include <torch-gobject/nn/torch-nn-any-module-internal.h>
+#include <torch-gobject/nn/torch-nn-transformer-encoder-layer-internal.h>
+#include <torch-gobject/torch-tensor-internal.h>
+
+#include <torch/torch.h>
+
+namespace
+{
+  /* Adds its second argument to the first, if there is one */
+  struct MaybeAddImpl : torch::nn::Cloneable <MaybeAddImpl>
+  {
+    void reset () override
+    {
+    }
+
+    torch::Tensor forward (torch::Tensor input,
+                           torch::Tensor other = {})
+    {
+      return other.defined () ? input + other : input * 1;
+    }
+
+  protected:
+    FORWARD_HAS_DEFAULT_ARGS ({1, torch::nn::AnyValue (torch::Tensor ())})
+  };
+
+  TORCH_MODULE (MaybeAdd);
+
+  TorchNNAnyModule *
+  make_maybe_add_module ()
+  {
+    return torch_nn_any_module_new_from_real_any_module (torch::nn::AnyModule (MaybeAdd ()));
+  }
+
+  void
+  add_input (GPtrArray           *inputs,
+             torch::Tensor const &input)
+  {
+    g_ptr_array_add (inputs, torch_tensor_new_from_real_tensor (input));
+  }
+
+  GPtrArray *
+  new_inputs ()
+  {
+    return g_ptr_array_new_with_free_func (g_object_unref);
+  }
+
+  TEST (TorchNNAnyModule, ForwardPassesPositionalArguments)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNAnyModule) module = make_maybe_add_module ();
+    g_autoptr (GPtrArray) inputs = new_inputs ();
+
+    add_input (inputs, torch::ones ({2}));
+    add_input (inputs, torch::full ({2}, 2.0));
+
+    g_autoptr (TorchTensor) output = torch_nn_any_module_forward (module, inputs, &error);
+
+    ASSERT_EQ (error, nullptr);
+    EXPECT_TRUE (torch::equal (torch_tensor_get_real_tensor (output), torch::full ({2}, 3.0)));
+  }
+
+  TEST (TorchNNAnyModule, ForwardLeavesOutDefaultedArguments)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNAnyModule) module = make_maybe_add_module ();
+    g_autoptr (GPtrArray) inputs = new_inputs ();
+
+    add_input (inputs, torch::ones ({2}));
+
+    g_autoptr (TorchTensor) output = torch_nn_any_module_forward (module, inputs, &error);
+
+    ASSERT_EQ (error, nullptr);
+    EXPECT_TRUE (torch::equal (torch_tensor_get_real_tensor (output), torch::ones ({2})));
+  }
+
+  TEST (TorchNNAnyModule, ForwardPassesNullAsEmptyTensor)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNAnyModule) module = make_maybe_add_module ();
+    g_autoptr (GPtrArray) inputs = new_inputs ();
+
+    add_input (inputs, torch::ones ({2}));
+    g_ptr_array_add (inputs, NULL);
+
+    g_autoptr (TorchTensor) output = torch_nn_any_module_forward (module, inputs, &error);
+
+    ASSERT_EQ (error, nullptr);
+    EXPECT_TRUE (torch::equal (torch_tensor_get_real_tensor (output), torch::ones ({2})));
+  }
+
+  TEST (TorchNNAnyModule, ForwardWithTooManyArgumentsFails)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNAnyModule) module = make_maybe_add_module ();
+    g_autoptr (GPtrArray) inputs = new_inputs ();
+
+    for (unsigned int i = 0; i < 9; ++i)
+      add_input (inputs, torch::ones ({2}));
+
+    g_autoptr (TorchTensor) output = torch_nn_any_module_forward (module, inputs, &error);
+
+    EXPECT_EQ (output, nullptr);
+    EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT));
+  }
+
+  TEST (TorchNNAnyModule, ForwardWithWrongArityFails)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNAnyModule) module = make_maybe_add_module ();
+    g_autoptr (GPtrArray) inputs = new_inputs ();
+
+    for (unsigned int i = 0; i < 3; ++i)
+      add_input (inputs, torch::ones ({2}));
+
+    g_autoptr (TorchTensor) output = torch_nn_any_module_forward (module, inputs, &error);
+
+    EXPECT_EQ (output, nullptr);
+    EXPECT_NE (error, nullptr);
+  }
+
+  TEST (TorchNNAnyModule, ForwardRunsInInferenceModeWhenSet)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNAnyModule) module = make_maybe_add_module ();
+    g_autoptr (GPtrArray) inputs = new_inputs ();
+
+    add_input (inputs, torch::ones ({2}));
+
+    g_autoptr (TorchTensor) normal_output = torch_nn_any_module_forward (module, inputs, &error);
+    ASSERT_EQ (error, nullptr);
+    EXPECT_FALSE (torch_tensor_get_real_tensor (normal_output).is_inference ());
+
+    torch_nn_any_module_set_inference_mode (module, TRUE);
+
+    g_autoptr (TorchTensor) inference_output = torch_nn_any_module_forward (module, inputs, &error);
+    ASSERT_EQ (error, nullptr);
+    EXPECT_TRUE (torch_tensor_get_real_tensor (inference_output).is_inference ());
+
+    /* The mode is only entered for the call */
+    EXPECT_FALSE (c10::InferenceMode::is_enabled ());
+  }
+
+  TEST (TorchNNAnyModuleCastable, ForwardMatchesUnderlyingModule)
+  {
+    g_autoptr (GError) error = NULL;
+    torch::nn::TransformerEncoderLayer layer (torch::nn::TransformerEncoderLayerOptions (4, 1).dropout (0.0));
+    g_autoptr (TorchNNTransformerEncoderLayer) wrapped = torch_nn_transformer_encoder_layer_new_from_real_transformer_encoder_layer (layer);
+    g_autoptr (GPtrArray) inputs = new_inputs ();
+    torch::Tensor input = torch::rand ({3, 1, 4});
+
+    add_input (inputs, input);
+
+    for (unsigned int i = 0; i < 2; ++i)
+      {
+        g_autoptr (TorchTensor) output = torch_nn_any_module_castable_forward (TORCH_NN_ANY_MODULE_CASTABLE (wrapped),
+                                                                               inputs,
+                                                                               &error);
+
+        ASSERT_EQ (error, nullptr);
+        EXPECT_TRUE (torch::allclose (torch_tensor_get_real_tensor (output), layer->forward (input)));
+      }
+  }
+}
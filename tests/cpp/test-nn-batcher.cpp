@@ -0,0 +1,294 @@
+/*
+ * tests/cpp/test-nn-batcher.cpp
+ *
+ * Tests for TorchNNBatcher.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <torch-gobject/nn/torch-nn-any-module-internal.h>
+#include <torch-gobject/nn/torch-nn-batcher.h>
+#include <torch-gobject/torch-tensor-internal.h>
+
+#include <torch/torch.h>
+
+namespace
+{
+  struct ForwardRecord
+  {
+    torch::Tensor batch;
+    torch::Tensor padding_mask;
+  };
+
+  /* Doubles its input and remembers the last batch and padding mask
+   * it was called with */
+  struct RecordingModuleImpl : torch::nn::Cloneable <RecordingModuleImpl>
+  {
+    explicit RecordingModuleImpl (std::shared_ptr <ForwardRecord> record) :
+      record (std::move (record))
+    {
+    }
+
+    void reset () override
+    {
+    }
+
+    torch::Tensor forward (torch::Tensor input,
+                           torch::Tensor padding_mask = {})
+    {
+      record->batch = input.clone ();
+      record->padding_mask = padding_mask.defined () ? padding_mask.clone () : padding_mask;
+
+      return input * 2;
+    }
+
+    std::shared_ptr <ForwardRecord> record;
+
+  protected:
+    FORWARD_HAS_DEFAULT_ARGS ({1, torch::nn::AnyValue (torch::Tensor ())})
+  };
+
+  TORCH_MODULE (RecordingModule);
+
+  struct ForwardResult
+  {
+    TorchTensor *output = nullptr;
+    GError      *error = nullptr;
+    bool         done = false;
+
+    ~ForwardResult ()
+    {
+      g_clear_object (&output);
+      g_clear_error (&error);
+    }
+  };
+
+  void
+  on_forward_done (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+  {
+    ForwardResult *forward_result = static_cast <ForwardResult *> (user_data);
+
+    forward_result->output = torch_nn_batcher_forward_finish (TORCH_NN_BATCHER (source),
+                                                              result,
+                                                              &forward_result->error);
+    forward_result->done = true;
+  }
+
+  void
+  wait_for_results (std::vector <std::unique_ptr <ForwardResult>> const &results)
+  {
+    for (auto const &result : results)
+      while (!result->done)
+        g_main_context_iteration (NULL, TRUE);
+  }
+
+  ForwardResult *
+  queue_forward (TorchNNBatcher      *batcher,
+                 torch::Tensor const &input)
+  {
+    g_autoptr (TorchTensor) tensor = torch_tensor_new_from_real_tensor (input);
+    ForwardResult *result = new ForwardResult ();
+
+    torch_nn_batcher_forward_async (batcher, tensor, NULL, on_forward_done, result);
+    return result;
+  }
+
+  TorchNNBatcher *
+  make_batcher (std::shared_ptr <ForwardRecord> record,
+                guint                           max_batch_size,
+                guint64                         max_wait_time)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNAnyModule) module = torch_nn_any_module_new_from_real_any_module (torch::nn::AnyModule (RecordingModule (record)));
+    TorchNNBatcher *batcher = static_cast <TorchNNBatcher *> (g_initable_new (TORCH_TYPE_NN_BATCHER,
+                                                                              NULL,
+                                                                              &error,
+                                                                              "module", module,
+                                                                              "max-batch-size", max_batch_size,
+                                                                              "max-wait-time", max_wait_time,
+                                                                              "padding-mask-argument", 1,
+                                                                              "padding-value", -1.0,
+                                                                              NULL));
+
+    EXPECT_EQ (error, nullptr);
+    return batcher;
+  }
+
+  guint64
+  sum_histogram (GArray *histogram)
+  {
+    guint64 sum = 0;
+
+    for (guint i = 0; i < histogram->len; ++i)
+      sum += g_array_index (histogram, guint64, i);
+
+    return sum;
+  }
+
+  /* Long enough that a batch only runs once it is full */
+  constexpr guint64 kLongWaitTime = 10 * G_USEC_PER_SEC;
+
+  TEST (TorchNNBatcher, ConstructionWithoutModuleFails)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchNNBatcher) batcher = torch_nn_batcher_new (NULL, 4, 1000, &error);
+
+    EXPECT_EQ (batcher, nullptr);
+    EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT));
+  }
+
+  TEST (TorchNNBatcher, PadsShorterSamples)
+  {
+    auto record = std::make_shared <ForwardRecord> ();
+    g_autoptr (TorchNNBatcher) batcher = make_batcher (record, 2, kLongWaitTime);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (batcher, nullptr);
+
+    results.emplace_back (queue_forward (batcher, torch::ones ({3, 2})));
+    results.emplace_back (queue_forward (batcher, torch::full ({1, 2}, 3.0)));
+    wait_for_results (results);
+
+    ASSERT_TRUE (record->batch.defined ());
+    EXPECT_EQ (record->batch.sizes (), torch::IntArrayRef ({3, 2, 2}));
+
+    /* Samples are stacked in the order they were queued */
+    torch::Tensor longer = record->batch.select (1, 0);
+    torch::Tensor shorter = record->batch.select (1, 1);
+
+    EXPECT_TRUE (torch::equal (longer, torch::ones ({3, 2})));
+    EXPECT_TRUE (torch::equal (shorter.narrow (0, 0, 1), torch::full ({1, 2}, 3.0)));
+    EXPECT_TRUE (torch::equal (shorter.narrow (0, 1, 2), torch::full ({2, 2}, -1.0)));
+  }
+
+  TEST (TorchNNBatcher, PassesPaddingMask)
+  {
+    auto record = std::make_shared <ForwardRecord> ();
+    g_autoptr (TorchNNBatcher) batcher = make_batcher (record, 2, kLongWaitTime);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (batcher, nullptr);
+
+    results.emplace_back (queue_forward (batcher, torch::ones ({3, 2})));
+    results.emplace_back (queue_forward (batcher, torch::ones ({1, 2})));
+    wait_for_results (results);
+
+    ASSERT_TRUE (record->padding_mask.defined ());
+    EXPECT_EQ (record->padding_mask.scalar_type (), torch::kBool);
+
+    /* Each row is true where that sample was padded */
+    EXPECT_TRUE (torch::equal (record->padding_mask,
+                               torch::tensor ({false, false, false,
+                                               false, true, true}).reshape ({2, 3})));
+  }
+
+  TEST (TorchNNBatcher, OmitsPaddingMaskWhenNothingIsPadded)
+  {
+    auto record = std::make_shared <ForwardRecord> ();
+    g_autoptr (TorchNNBatcher) batcher = make_batcher (record, 2, kLongWaitTime);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (batcher, nullptr);
+
+    results.emplace_back (queue_forward (batcher, torch::ones ({2, 2})));
+    results.emplace_back (queue_forward (batcher, torch::ones ({2, 2})));
+    wait_for_results (results);
+
+    ASSERT_TRUE (record->batch.defined ());
+    EXPECT_FALSE (record->padding_mask.defined ());
+  }
+
+  TEST (TorchNNBatcher, SlicesOutputAndTrimsPadding)
+  {
+    auto record = std::make_shared <ForwardRecord> ();
+    g_autoptr (TorchNNBatcher) batcher = make_batcher (record, 2, kLongWaitTime);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+    torch::Tensor longer = torch::arange (6, torch::kFloat).reshape ({3, 2});
+    torch::Tensor shorter = torch::full ({1, 2}, 7.0);
+
+    ASSERT_NE (batcher, nullptr);
+
+    results.emplace_back (queue_forward (batcher, longer));
+    results.emplace_back (queue_forward (batcher, shorter));
+    wait_for_results (results);
+
+    ASSERT_EQ (results[0]->error, nullptr);
+    ASSERT_EQ (results[1]->error, nullptr);
+    EXPECT_TRUE (torch::equal (torch_tensor_get_real_tensor (results[0]->output), longer * 2));
+    EXPECT_TRUE (torch::equal (torch_tensor_get_real_tensor (results[1]->output), shorter * 2));
+  }
+
+  TEST (TorchNNBatcher, FlushesPartialBatchAtDeadline)
+  {
+    constexpr guint64 max_wait_time = 20000;
+    auto record = std::make_shared <ForwardRecord> ();
+    g_autoptr (TorchNNBatcher) batcher = make_batcher (record, 8, max_wait_time);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (batcher, nullptr);
+
+    gint64 start = g_get_monotonic_time ();
+
+    results.emplace_back (queue_forward (batcher, torch::ones ({1, 2})));
+    wait_for_results (results);
+
+    EXPECT_GE (static_cast <guint64> (g_get_monotonic_time () - start), max_wait_time);
+    ASSERT_EQ (results[0]->error, nullptr);
+    EXPECT_EQ (record->batch.sizes (), torch::IntArrayRef ({1, 1, 2}));
+  }
+
+  TEST (TorchNNBatcher, RecordsAndResetsHistograms)
+  {
+    auto record = std::make_shared <ForwardRecord> ();
+    g_autoptr (TorchNNBatcher) batcher = make_batcher (record, 2, kLongWaitTime);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (batcher, nullptr);
+
+    results.emplace_back (queue_forward (batcher, torch::ones ({1, 2})));
+    results.emplace_back (queue_forward (batcher, torch::ones ({1, 2})));
+    wait_for_results (results);
+
+    g_autoptr (GArray) batch_sizes = torch_nn_batcher_get_batch_size_histogram (batcher);
+    g_autoptr (GArray) queue_depths = torch_nn_batcher_get_queue_depth_histogram (batcher);
+
+    ASSERT_EQ (batch_sizes->len, 2u);
+    EXPECT_EQ (g_array_index (batch_sizes, guint64, 0), 0u);
+    EXPECT_EQ (g_array_index (batch_sizes, guint64, 1), 1u);
+
+    /* The second request may or may not have been queued yet when the
+     * first was picked up, but there was exactly one batch */
+    ASSERT_EQ (queue_depths->len, 33u);
+    EXPECT_EQ (g_array_index (queue_depths, guint64, 0), 0u);
+    EXPECT_EQ (sum_histogram (queue_depths), 1u);
+
+    torch_nn_batcher_reset_histograms (batcher);
+
+    g_autoptr (GArray) reset_batch_sizes = torch_nn_batcher_get_batch_size_histogram (batcher);
+    g_autoptr (GArray) reset_queue_depths = torch_nn_batcher_get_queue_depth_histogram (batcher);
+
+    EXPECT_EQ (sum_histogram (reset_batch_sizes), 0u);
+    EXPECT_EQ (sum_histogram (reset_queue_depths), 0u);
+  }
+}
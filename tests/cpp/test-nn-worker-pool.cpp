@@ -0,0 +1,263 @@
+/*
+ * tests/cpp/test-nn-worker-pool.cpp
+ *
+ * Tests for TorchNNWorkerPool.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <torch-gobject/nn/torch-nn-any-module-internal.h>
+#include <torch-gobject/nn/torch-nn-worker-pool.h>
+#include <torch-gobject/torch-tensor-internal.h>
+
+#include <torch/torch.h>
+
+namespace
+{
+  struct ForwardResult
+  {
+    TorchTensor *output = nullptr;
+    GError      *error = nullptr;
+    bool         done = false;
+
+    ~ForwardResult ()
+    {
+      g_clear_object (&output);
+      g_clear_error (&error);
+    }
+  };
+
+  void
+  on_forward_done (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+  {
+    ForwardResult *forward_result = static_cast <ForwardResult *> (user_data);
+
+    forward_result->output = torch_nn_worker_pool_forward_finish (TORCH_NN_WORKER_POOL (source),
+                                                                  result,
+                                                                  &forward_result->error);
+    forward_result->done = true;
+  }
+
+  void
+  wait_for_results (std::vector <std::unique_ptr <ForwardResult>> const &results)
+  {
+    for (auto const &result : results)
+      while (!result->done)
+        g_main_context_iteration (NULL, TRUE);
+  }
+
+  GPtrArray *
+  make_inputs (torch::Tensor const &input)
+  {
+    GPtrArray *inputs = g_ptr_array_new_with_free_func (g_object_unref);
+
+    g_ptr_array_add (inputs, torch_tensor_new_from_real_tensor (input));
+    return inputs;
+  }
+
+  ForwardResult *
+  queue_forward (TorchNNWorkerPool   *pool,
+                 torch::Tensor const &input)
+  {
+    g_autoptr (GPtrArray) inputs = make_inputs (input);
+    ForwardResult *result = new ForwardResult ();
+
+    torch_nn_worker_pool_forward_async (pool, inputs, NULL, on_forward_done, result);
+    return result;
+  }
+
+  /* Blocks every forward pass until it is opened, so that the tests
+   * control how many jobs are running and how many are queued */
+  struct Gate
+  {
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    open = false;
+    unsigned int            n_entered = 0;
+
+    void pass ()
+    {
+      std::unique_lock <std::mutex> lock (mutex);
+
+      ++n_entered;
+      cond.notify_all ();
+      cond.wait (lock, [this]() { return open; });
+    }
+
+    void wait_for_entered (unsigned int n)
+    {
+      std::unique_lock <std::mutex> lock (mutex);
+
+      cond.wait (lock, [this, n]() { return n_entered >= n; });
+    }
+
+    void release ()
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+
+      open = true;
+      cond.notify_all ();
+    }
+  };
+
+  TorchNNAnyModule *
+  make_gated_module (std::shared_ptr <Gate> gate)
+  {
+    return torch_nn_any_module_new_from_real_any_module (torch::nn::AnyModule (torch::nn::Functional ([gate](torch::Tensor input) {
+      gate->pass ();
+      return input * 2;
+    })));
+  }
+
+  TorchNNWorkerPool *
+  make_pool (TorchNNAnyModule *module,
+             guint             n_replicas,
+             guint             queue_capacity)
+  {
+    g_autoptr (GError) error = NULL;
+    TorchNNWorkerPool *pool = static_cast <TorchNNWorkerPool *> (g_initable_new (TORCH_TYPE_NN_WORKER_POOL,
+                                                                                 NULL,
+                                                                                 &error,
+                                                                                 "module", module,
+                                                                                 "n-replicas", n_replicas,
+                                                                                 "queue-capacity", queue_capacity,
+                                                                                 NULL));
+
+    EXPECT_EQ (error, nullptr);
+    return pool;
+  }
+
+  TEST (TorchNNWorkerPool, ConcurrentForwardsMatchModule)
+  {
+    torch::nn::Linear linear (4, 2);
+    g_autoptr (TorchNNAnyModule) module = torch_nn_any_module_new_from_real_any_module (torch::nn::AnyModule (linear));
+    g_autoptr (TorchNNWorkerPool) pool = make_pool (module, 4, 64);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+    std::vector <torch::Tensor> inputs;
+
+    ASSERT_NE (pool, nullptr);
+
+    for (unsigned int i = 0; i < 32; ++i)
+      {
+        inputs.push_back (torch::full ({1, 4}, static_cast <float> (i)));
+        results.emplace_back (queue_forward (pool, inputs.back ()));
+      }
+
+    wait_for_results (results);
+
+    torch::NoGradGuard no_grad;
+
+    for (size_t i = 0; i < results.size (); ++i)
+      {
+        ASSERT_EQ (results[i]->error, nullptr);
+        EXPECT_TRUE (torch::allclose (torch_tensor_get_real_tensor (results[i]->output),
+                                      linear->forward (inputs[i])));
+      }
+  }
+
+  TEST (TorchNNWorkerPool, FullQueueReturnsBusy)
+  {
+    auto gate = std::make_shared <Gate> ();
+    g_autoptr (TorchNNAnyModule) module = make_gated_module (gate);
+    g_autoptr (TorchNNWorkerPool) pool = make_pool (module, 1, 2);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (pool, nullptr);
+
+    /* One job is running and two are queued, so the fourth cannot
+     * fit no matter how quickly the worker picked up the first */
+    results.emplace_back (queue_forward (pool, torch::ones ({1})));
+    gate->wait_for_entered (1);
+
+    for (unsigned int i = 0; i < 3; ++i)
+      results.emplace_back (queue_forward (pool, torch::ones ({1})));
+
+    gate->release ();
+    wait_for_results (results);
+
+    for (size_t i = 0; i < 3; ++i)
+      EXPECT_EQ (results[i]->error, nullptr);
+
+    EXPECT_TRUE (g_error_matches (results[3]->error, G_IO_ERROR, G_IO_ERROR_BUSY));
+    EXPECT_EQ (results[3]->output, nullptr);
+  }
+
+  TEST (TorchNNWorkerPool, ShutdownCancelsQueuedJobs)
+  {
+    auto gate = std::make_shared <Gate> ();
+    g_autoptr (TorchNNAnyModule) module = make_gated_module (gate);
+    g_autoptr (TorchNNWorkerPool) pool = make_pool (module, 1, 8);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (pool, nullptr);
+
+    results.emplace_back (queue_forward (pool, torch::ones ({1})));
+    gate->wait_for_entered (1);
+
+    for (unsigned int i = 0; i < 3; ++i)
+      results.emplace_back (queue_forward (pool, torch::ones ({1})));
+
+    /* Shutting down waits for the running job, so let it finish
+     * once the pool has been told to stop */
+    std::thread releaser ([gate]() {
+      std::this_thread::sleep_for (std::chrono::milliseconds (100));
+      gate->release ();
+    });
+
+    g_object_run_dispose (G_OBJECT (pool));
+    releaser.join ();
+    wait_for_results (results);
+
+    EXPECT_EQ (results[0]->error, nullptr);
+
+    for (size_t i = 1; i < results.size (); ++i)
+      EXPECT_TRUE (g_error_matches (results[i]->error, G_IO_ERROR, G_IO_ERROR_CANCELLED));
+  }
+
+  TEST (TorchNNWorkerPool, LastReferenceDroppedWhileJobsRun)
+  {
+    auto gate = std::make_shared <Gate> ();
+    g_autoptr (TorchNNAnyModule) module = make_gated_module (gate);
+    TorchNNWorkerPool *pool = make_pool (module, 2, 8);
+    std::vector <std::unique_ptr <ForwardResult>> results;
+
+    ASSERT_NE (pool, nullptr);
+
+    for (unsigned int i = 0; i < 4; ++i)
+      results.emplace_back (queue_forward (pool, torch::ones ({1})));
+
+    /* From here on only the pending tasks keep the pool alive, so the
+     * last reference may be dropped by whichever thread finishes last */
+    g_object_unref (pool);
+    gate->release ();
+    wait_for_results (results);
+
+    for (auto const &result : results)
+      EXPECT_EQ (result->error, nullptr);
+  }
+}
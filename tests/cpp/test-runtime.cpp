@@ -0,0 +1,135 @@
+/*
+ * tests/cpp/test-runtime.cpp
+ *
+ * Tests for TorchRuntime.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#include <torch-gobject/torch-runtime.h>
+#include <torch-gobject/torch-runtime-internal.h>
+
+namespace
+{
+#ifdef __linux__
+  cpu_set_t
+  current_thread_mask ()
+  {
+    cpu_set_t mask;
+
+    CPU_ZERO (&mask);
+    pthread_getaffinity_np (pthread_self (), sizeof (cpu_set_t), &mask);
+    return mask;
+  }
+
+  int
+  first_allowed_cpu (cpu_set_t const &mask)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET (cpu, &mask))
+        return cpu;
+
+    return -1;
+  }
+
+  TEST (TorchRuntime, SetCpuAffinityPinsCallingThread)
+  {
+    g_autoptr (GError) error = NULL;
+    TorchRuntime *runtime = torch_runtime_get_default ();
+    cpu_set_t original = current_thread_mask ();
+    int cpu = first_allowed_cpu (original);
+    g_autofree char *cpu_list = g_strdup_printf ("%d", cpu);
+
+    ASSERT_GE (cpu, 0);
+    ASSERT_TRUE (torch_runtime_set_cpu_affinity (runtime, cpu_list, &error));
+    ASSERT_EQ (error, nullptr);
+    EXPECT_STREQ (torch_runtime_get_cpu_affinity (runtime), cpu_list);
+
+    cpu_set_t pinned = current_thread_mask ();
+    EXPECT_EQ (CPU_COUNT (&pinned), 1);
+    EXPECT_TRUE (CPU_ISSET (cpu, &pinned));
+
+    ASSERT_TRUE (torch_runtime_set_cpu_affinity (runtime, NULL, &error));
+    EXPECT_EQ (torch_runtime_get_cpu_affinity (runtime), nullptr);
+
+    cpu_set_t restored = current_thread_mask ();
+    EXPECT_TRUE (CPU_EQUAL (&restored, &original));
+  }
+
+  TEST (TorchRuntime, WorkerThreadsApplyCpuAffinityLazily)
+  {
+    g_autoptr (GError) error = NULL;
+    TorchRuntime *runtime = torch_runtime_get_default ();
+    cpu_set_t original = current_thread_mask ();
+    int cpu = first_allowed_cpu (original);
+    g_autofree char *cpu_list = g_strdup_printf ("%d", cpu);
+    cpu_set_t worker_mask;
+
+    ASSERT_GE (cpu, 0);
+
+    /* Started before the mask is set, so it does not inherit it and
+     * only picks it up when it applies it, like a worker does before
+     * each job */
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    mask_set = false;
+
+    std::thread worker ([&]() {
+      std::unique_lock <std::mutex> lock (mutex);
+
+      cond.wait (lock, [&]() { return mask_set; });
+      torch_runtime_apply_cpu_affinity_to_current_thread ();
+      worker_mask = current_thread_mask ();
+    });
+
+    ASSERT_TRUE (torch_runtime_set_cpu_affinity (runtime, cpu_list, &error));
+
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+      mask_set = true;
+      cond.notify_all ();
+    }
+
+    worker.join ();
+
+    EXPECT_EQ (CPU_COUNT (&worker_mask), 1);
+    EXPECT_TRUE (CPU_ISSET (cpu, &worker_mask));
+
+    ASSERT_TRUE (torch_runtime_set_cpu_affinity (runtime, NULL, &error));
+  }
+
+  TEST (TorchRuntime, SetCpuAffinityRejectsMalformedLists)
+  {
+    g_autoptr (GError) error = NULL;
+    TorchRuntime *runtime = torch_runtime_get_default ();
+
+    EXPECT_FALSE (torch_runtime_set_cpu_affinity (runtime, "0-,x", &error));
+    EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT));
+  }
+#endif
+}
@@ -0,0 +1,147 @@
+/*
+ * tests/cpp/test-storage.cpp
+ *
+ * Tests for TorchStorage.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <torch-gobject/torch-storage.h>
+#include <torch-gobject/torch-storage-internal.h>
+
+#include <torch/torch.h>
+
+namespace
+{
+  const guint8 kData[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+  void
+  set_flag (gpointer data)
+  {
+    *static_cast <gboolean *> (data) = TRUE;
+  }
+
+  TEST (TorchStorage, FixedDataSharesMemoryWithBytes)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GBytes) bytes = g_bytes_new_static (kData, sizeof (kData));
+    g_autoptr (TorchStorage) storage = torch_storage_new_with_fixed_data (bytes, &error);
+
+    ASSERT_EQ (error, nullptr);
+    ASSERT_NE (storage, nullptr);
+
+    EXPECT_EQ (torch_storage_get_data (storage, &error), static_cast <gconstpointer> (kData));
+    EXPECT_EQ (error, nullptr);
+  }
+
+  TEST (TorchStorage, FixedDataHasSizeOfBytes)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GBytes) bytes = g_bytes_new_static (kData, sizeof (kData));
+    g_autoptr (TorchStorage) storage = torch_storage_new_with_fixed_data (bytes, &error);
+    size_t n_bytes = 0;
+
+    ASSERT_TRUE (torch_storage_get_n_bytes (storage, &n_bytes, &error));
+    EXPECT_EQ (n_bytes, sizeof (kData));
+  }
+
+  TEST (TorchStorage, FixedDataKeepsBytesAliveUntilStorageIsDestroyed)
+  {
+    g_autoptr (GError) error = NULL;
+    gboolean freed = FALSE;
+    GBytes *bytes = g_bytes_new_with_free_func (kData, sizeof (kData), set_flag, &freed);
+    TorchStorage *storage = torch_storage_new_with_fixed_data (bytes, &error);
+
+    ASSERT_NE (storage, nullptr);
+
+    g_bytes_unref (bytes);
+    EXPECT_FALSE (freed);
+
+    g_object_unref (storage);
+    EXPECT_TRUE (freed);
+  }
+
+  TEST (TorchStorage, PeekBytesAliasesFixedStorage)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (GBytes) bytes = g_bytes_new_static (kData, sizeof (kData));
+    g_autoptr (TorchStorage) storage = torch_storage_new_with_fixed_data (bytes, &error);
+    g_autoptr (GBytes) peeked = torch_storage_peek_bytes (storage, &error);
+
+    ASSERT_NE (peeked, nullptr);
+    EXPECT_EQ (g_bytes_get_data (peeked, NULL), static_cast <gconstpointer> (kData));
+    EXPECT_EQ (g_bytes_get_size (peeked), sizeof (kData));
+  }
+
+  TEST (TorchStorage, PeekBytesOutlivesStorage)
+  {
+    g_autoptr (GError) error = NULL;
+    gboolean freed = FALSE;
+    GBytes *bytes = g_bytes_new_with_free_func (kData, sizeof (kData), set_flag, &freed);
+    TorchStorage *storage = torch_storage_new_with_fixed_data (bytes, &error);
+    GBytes *peeked = torch_storage_peek_bytes (storage, &error);
+
+    g_bytes_unref (bytes);
+    g_object_unref (storage);
+    EXPECT_FALSE (freed);
+
+    g_bytes_unref (peeked);
+    EXPECT_TRUE (freed);
+  }
+
+  TEST (TorchStorage, PeekBytesCopiesResizableStorage)
+  {
+    g_autoptr (GError) error = NULL;
+    g_autoptr (TorchAllocator) allocator = torch_allocator_new ();
+    g_autoptr (TorchStorage) storage = torch_storage_new_with_allocator (sizeof (kData), allocator, TRUE, &error);
+    g_autoptr (GBytes) peeked = torch_storage_peek_bytes (storage, &error);
+
+    ASSERT_NE (peeked, nullptr);
+    EXPECT_NE (g_bytes_get_data (peeked, NULL), static_cast <gconstpointer> (torch_storage_get_data (storage, &error)));
+    EXPECT_EQ (g_bytes_get_size (peeked), sizeof (kData));
+  }
+
+  TEST (TorchStorage, AllocatorOutlivesStorageWhileTensorsUseIt)
+  {
+    g_autoptr (GError) error = NULL;
+    TorchAllocator *allocator = torch_allocator_new ();
+    TorchStorage *storage = torch_storage_new_with_allocator (sizeof (kData), allocator, TRUE, &error);
+
+    ASSERT_NE (storage, nullptr);
+
+    g_object_add_weak_pointer (G_OBJECT (allocator), reinterpret_cast <gpointer *> (&allocator));
+    g_object_unref (allocator);
+
+    torch::Tensor tensor = torch::empty ({0}, torch::kByte).set_ (torch_storage_get_real_storage (storage),
+                                                                   0,
+                                                                   { static_cast <int64_t> (sizeof (kData)) },
+                                                                   { 1 });
+
+    g_object_unref (storage);
+    ASSERT_NE (allocator, nullptr);
+
+    /* Resizing allocates through the allocator again */
+    tensor.resize_ ({ 64 });
+    EXPECT_GE (tensor.storage ().nbytes (), 64u);
+    EXPECT_NE (allocator, nullptr);
+
+    tensor.reset ();
+    EXPECT_EQ (allocator, nullptr);
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * tests/js/torch-gobject/testAllocator.js
+ *
+ * Tests for the JavaScript Binding to the Allocator Object.
+ *
+ * Copyright (C) 2021 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+const { GLib, GObject, Torch } = imports.gi;
+
+describe('TorchAllocator', function() {
+  it('can be constructed', function() {
+    let allocator = Torch.Allocator.new();
+  });
+
+  it('can be constructed as a caching allocator', function() {
+    let allocator = Torch.Allocator.new_caching(1024 * 1024);
+
+    expect(allocator.caching).toBe(true);
+    expect(allocator.max_retained_bytes).toEqual(1024 * 1024);
+  });
+
+  it('counts a miss for a new caching allocation', function() {
+    let allocator = Torch.Allocator.new_caching(1024 * 1024);
+    let storage = Torch.Storage.new_with_allocator(256, allocator, false);
+
+    expect(storage.n_bytes).toEqual(256);
+    expect(allocator.get_cache_statistics()).toEqual([0, 1, 0]);
+  });
+
+  it('has no statistics when not caching', function() {
+    let allocator = Torch.Allocator.new();
+    let storage = Torch.Storage.new_with_allocator(256, allocator, false);
+
+    expect(allocator.get_cache_statistics()).toEqual([0, 0, 0]);
+  });
+
+  it('can be constructed as an arena allocator', function() {
+    let allocator = Torch.ArenaAllocator.new(4096);
+
+    expect(allocator instanceof Torch.Allocator).toBe(true);
+    expect(allocator.slab_size).toEqual(4096);
+  });
+
+  it('carves aligned storage out of an arena', function() {
+    let allocator = Torch.ArenaAllocator.new(4096);
+    let storage = Torch.Storage.new_with_allocator(100, allocator, false);
+
+    expect(allocator.get_bytes_in_use()).toEqual(128);
+  });
+
+  it('has no bytes in use after a reset', function() {
+    let allocator = Torch.ArenaAllocator.new(4096);
+
+    allocator.reset();
+
+    expect(allocator.get_bytes_in_use()).toEqual(0);
+  });
+});
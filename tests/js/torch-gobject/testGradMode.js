@@ -0,0 +1,69 @@
+/*
+ * tests/js/torch-gobject/testGradMode.js
+ *
+ * Tests for the JavaScript Binding to the inference and no-grad modes.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+const { Torch } = imports.gi;
+
+describe('TorchGradMode', function() {
+  it('is not in inference mode by default', function() {
+    expect(Torch.inference_mode_is_enabled()).toBeFalsy();
+    expect(Torch.grad_mode_is_enabled()).toBeTruthy();
+  });
+
+  it('can enter and leave inference mode', function() {
+    Torch.inference_mode_enter();
+    expect(Torch.inference_mode_is_enabled()).toBeTruthy();
+    expect(Torch.grad_mode_is_enabled()).toBeFalsy();
+
+    Torch.inference_mode_leave();
+    expect(Torch.inference_mode_is_enabled()).toBeFalsy();
+    expect(Torch.grad_mode_is_enabled()).toBeTruthy();
+  });
+
+  it('can enter and leave no-grad mode', function() {
+    Torch.no_grad_enter();
+    expect(Torch.grad_mode_is_enabled()).toBeFalsy();
+    expect(Torch.inference_mode_is_enabled()).toBeFalsy();
+
+    Torch.no_grad_leave();
+    expect(Torch.grad_mode_is_enabled()).toBeTruthy();
+  });
+
+  it('restores the outer scope when leaving a nested one', function() {
+    Torch.inference_mode_enter();
+    Torch.no_grad_enter();
+    Torch.no_grad_leave();
+    expect(Torch.inference_mode_is_enabled()).toBeTruthy();
+
+    Torch.inference_mode_leave();
+    expect(Torch.inference_mode_is_enabled()).toBeFalsy();
+  });
+
+  it('throws when leaving a scope that was not entered', function() {
+    expect(() => Torch.inference_mode_leave()).toThrow();
+  });
+
+  it('throws when leaving scopes out of order', function() {
+    Torch.no_grad_enter();
+    expect(() => Torch.inference_mode_leave()).toThrow();
+    Torch.no_grad_leave();
+  });
+});
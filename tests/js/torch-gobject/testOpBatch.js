@@ -0,0 +1,117 @@
+/*
+ * tests/js/torch-gobject/testOpBatch.js
+ *
+ * Tests for the JavaScript Binding to the OpBatch Object.
+ *
+ * Copyright (C) 2021 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+const { GLib, GObject, Torch } = imports.gi;
+
+const slot = s => new GLib.Variant('u', s);
+const args = values => new GLib.Variant('av', values);
+
+describe('TorchOpBatch', function() {
+  let opts;
+
+  beforeEach(function() {
+    opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+  });
+
+  it('can be constructed', function() {
+    let batch = Torch.OpBatch.new();
+
+    expect(batch.get_n_slots()).toEqual(0);
+  });
+
+  it('runs a chain of ops and returns the last output', function() {
+    let batch = Torch.OpBatch.new();
+    let a = batch.add_input(Torch.linspace_double(1.0, 3.0, 3, opts));
+    let b = batch.add_input(Torch.linspace_double(1.0, 3.0, 3, opts));
+
+    let [sum] = batch.add_op('add', 'Tensor', args([slot(a), slot(b)]));
+    batch.add_op('mul', 'Tensor', args([slot(sum), slot(a)]));
+
+    let [result] = batch.run(null);
+
+    expect(result.get_tensor_data().deep_unpack()).toEqual([2, 8, 18]);
+  });
+
+  it('only returns the requested slots', function() {
+    let batch = Torch.OpBatch.new();
+    let a = batch.add_input(Torch.linspace_double(1.0, 3.0, 3, opts));
+
+    let [negated] = batch.add_op('neg', null, args([slot(a)]));
+    batch.add_op('abs', null, args([slot(negated)]));
+
+    let outputs = batch.run([negated]);
+
+    expect(outputs.length).toEqual(1);
+    expect(outputs[0].get_tensor_data().deep_unpack()).toEqual([-1, -2, -3]);
+  });
+
+  it('passes constants and tensor lists', function() {
+    let batch = Torch.OpBatch.new();
+    let a = batch.add_input(Torch.linspace_double(1.0, 2.0, 2, opts));
+    let b = batch.add_input(Torch.linspace_double(3.0, 4.0, 2, opts));
+
+    batch.add_op('cat', null, args([new GLib.Variant('au', [a, b]),
+                                    new GLib.Variant('x', 0)]));
+
+    let [result] = batch.run(null);
+
+    expect(result.get_tensor_data().deep_unpack()).toEqual([1, 2, 3, 4]);
+  });
+
+  it('can be run again with new inputs', function() {
+    let batch = Torch.OpBatch.new();
+    let a = batch.add_input(Torch.linspace_double(1.0, 3.0, 3, opts));
+
+    batch.add_op('neg', null, args([slot(a)]));
+    batch.set_input(a, Torch.linspace_double(4.0, 6.0, 3, opts));
+
+    let [result] = batch.run(null);
+
+    expect(result.get_tensor_data().deep_unpack()).toEqual([-4, -5, -6]);
+  });
+
+  it('rejects unknown operators', function() {
+    let batch = Torch.OpBatch.new();
+
+    expect(() => batch.add_op('not_an_op', null, args([]))).toThrowError(/not_an_op/);
+  });
+
+  it('rejects references to slots that do not exist yet', function() {
+    let batch = Torch.OpBatch.new();
+
+    expect(() => batch.add_op('neg', null, args([slot(0)]))).toThrowError(/Slot 0/);
+  });
+
+  it('can run asynchronously', function(done) {
+    let batch = Torch.OpBatch.new();
+    let a = batch.add_input(Torch.linspace_double(1.0, 3.0, 3, opts));
+
+    batch.add_op('neg', null, args([slot(a)]));
+
+    batch.run_async(null, null, (obj, result) => {
+      let [negated] = batch.run_finish(result);
+
+      expect(negated.get_tensor_data().deep_unpack()).toEqual([-1, -2, -3]);
+      done();
+    });
+  });
+});
@@ -0,0 +1,51 @@
+/*
+ * tests/js/torch-gobject/testRuntime.js
+ *
+ * Tests for the JavaScript Binding to the Runtime Object.
+ *
+ * Copyright (C) 2021 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+const { Torch } = imports.gi;
+
+describe('TorchRuntime', function() {
+  it('is a singleton', function() {
+    expect(Torch.Runtime.get_default()).toBe(Torch.Runtime.get_default());
+  });
+
+  it('can change the number of intra-op threads', function() {
+    let runtime = Torch.Runtime.get_default();
+    let original = runtime.num_threads;
+
+    runtime.set_num_threads(1);
+    expect(runtime.num_threads).toEqual(1);
+
+    runtime.set_num_threads(original);
+    expect(runtime.get_num_threads()).toEqual(original);
+  });
+
+  it('describes the parallelization settings', function() {
+    expect(Torch.Runtime.get_default().get_parallel_info().length).toBeGreaterThan(0);
+  });
+
+  it('rejects malformed CPU lists', function() {
+    let runtime = Torch.Runtime.get_default();
+
+    expect(() => runtime.set_cpu_affinity('0-,x')).toThrow();
+    expect(runtime.cpu_affinity).toBe(null);
+  });
+});
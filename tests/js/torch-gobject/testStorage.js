@@ -0,0 +1,63 @@
+/*
+ * tests/js/torch-gobject/testStorage.js
+ *
+ * Tests for the JavaScript Binding to the Storage Object.
+ *
+ * Copyright (C) 2021 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+const { Gio, GLib, GObject, Torch } = imports.gi;
+
+describe('TorchStorage', function() {
+  let path;
+
+  beforeEach(function() {
+    let [file, stream] = Gio.File.new_tmp('torch-gobject-storage-XXXXXX');
+    stream.output_stream.write_bytes(new GLib.Bytes(new Uint8Array([1, 2, 3, 4, 5, 6, 7, 8])), null);
+    stream.close(null);
+    path = file.get_path();
+  });
+
+  afterEach(function() {
+    Gio.File.new_for_path(path).delete(null);
+  });
+
+  it('can be constructed with an allocator', function() {
+    let storage = Torch.Storage.new_with_allocator(16, Torch.Allocator.new(), false);
+
+    expect(storage.n_bytes).toEqual(16);
+  });
+
+  it('can be constructed from a mapped file', function() {
+    let storage = Torch.Storage.new_from_mapped_file(Gio.File.new_for_path(path), 0, 0, false);
+
+    expect(storage.n_bytes).toEqual(8);
+    expect(Array.from(storage.get_bytes().toArray())).toEqual([1, 2, 3, 4, 5, 6, 7, 8]);
+  });
+
+  it('can be constructed from part of a mapped file', function() {
+    let storage = Torch.Storage.new_from_mapped_file(Gio.File.new_for_path(path), 2, 4, false);
+
+    expect(Array.from(storage.get_bytes().toArray())).toEqual([3, 4, 5, 6]);
+  });
+
+  it('cannot map past the end of a file', function() {
+    expect(() => {
+      Torch.Storage.new_from_mapped_file(Gio.File.new_for_path(path), 4, 8, false);
+    }).toThrow();
+  });
+});
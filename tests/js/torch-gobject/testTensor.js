@@ -20,7 +20,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-const { GLib, GObject, Torch } = imports.gi;
+const { Gio, GLib, GObject, Torch } = imports.gi;
 
 describe('TorchTensor', function() {
   it('can be constructed', function() {
@@ -35,6 +35,110 @@ describe('TorchTensor', function() {
     expect(tensor.get_tensor_data().deep_unpack()).toEqual([2.0, 2.0]);
   });
 
+  it('can be constructed with nested data', function() {
+    let tensor = new Torch.Tensor({
+      data: new GLib.Variant("v", new GLib.Variant("av", [
+        new GLib.Variant("ad", [1.0, 2.0, 3.0]),
+        new GLib.Variant("ad", [4.0, 5.0, 6.0])
+      ]))
+    });
+
+    expect(tensor.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[1.0, 2.0, 3.0], [4.0, 5.0, 6.0]]);
+  });
+
+  it('can be constructed with uint8 data', function() {
+    let tensor = new Torch.Tensor({
+      data: new GLib.Variant("v", new GLib.Variant("ay", [0, 128, 255]))
+    });
+
+    expect(tensor.get_dtype()).toEqual(GObject.TYPE_UCHAR);
+    expect(Array.from(tensor.get_tensor_data().deep_unpack())).toEqual([0, 128, 255]);
+  });
+
+  it('can be constructed with int16 data', function() {
+    let tensor = new Torch.Tensor({
+      data: new GLib.Variant("v", new GLib.Variant("an", [-1, 2, 3]))
+    });
+
+    expect(Array.from(tensor.get_tensor_data().deep_unpack())).toEqual([-1, 2, 3]);
+  });
+
+  it('has no dtype for int16 data', function() {
+    let tensor = new Torch.Tensor({
+      data: new GLib.Variant("v", new GLib.Variant("an", [-1, 2, 3]))
+    });
+
+    expect(() => tensor.get_dtype()).toThrow();
+  });
+
+  it('keeps the int32 dtype when created from its GType', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_INT });
+    let tensor = Torch.ones([2], opts);
+
+    expect(tensor.get_dtype()).toEqual(GObject.TYPE_INT);
+    expect(tensor.get_tensor_data().get_type_string()).toEqual("ai");
+  });
+
+  it('serializes float32 data as tagged raw bytes', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_FLOAT });
+    let tensor = Torch.ones([2], opts);
+    let [dtype, bytes] = tensor.get_tensor_data().deep_unpack();
+
+    expect(dtype).toEqual("float32");
+    expect(Array.from(new Float32Array(bytes.slice().buffer))).toEqual([1.0, 1.0]);
+  });
+
+  it('round-trips float32 data', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_FLOAT });
+    let tensor = Torch.ones([2, 2], opts);
+    let copy = new Torch.Tensor({
+      data: new GLib.Variant("v", tensor.get_tensor_data())
+    });
+
+    let [status, equal] = tensor.equal(copy);
+
+    expect(copy.get_dtype()).toEqual(GObject.TYPE_FLOAT);
+    expect(equal).toEqual(true);
+  });
+
+  it('can get flat data', function() {
+    let tensor = new Torch.Tensor({
+      data: new GLib.Variant("v", new GLib.Variant("av", [
+        new GLib.Variant("ad", [1.0, 2.0, 3.0]),
+        new GLib.Variant("ad", [4.0, 5.0, 6.0])
+      ]))
+    });
+
+    expect(tensor.get_flat_variant().deep_unpack()).toEqual(["float64", [2, 3], [1.0, 2.0, 3.0, 4.0, 5.0, 6.0]]);
+  });
+
+  it('can be constructed with flat data', function() {
+    let tensor = new Torch.Tensor({
+      data: new GLib.Variant("v", new GLib.Variant("(satax)", ["int64", [2, 2], [1, 2, 3, 4]]))
+    });
+
+    expect(tensor.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[1, 2], [3, 4]]);
+  });
+
+  it('cannot be constructed with flat data that does not match its shape', function() {
+    let tensor = new Torch.Tensor({});
+
+    expect(() => {
+      tensor.set_data(new GLib.Variant("(satax)", ["int64", [2, 2], [1, 2, 3]]));
+    }).toThrow();
+  });
+
+  it('cannot set non-rectangular nested data', function() {
+    let tensor = new Torch.Tensor({});
+
+    expect(() => {
+      tensor.set_data(new GLib.Variant("av", [
+        new GLib.Variant("ad", [1.0, 2.0, 3.0]),
+        new GLib.Variant("ad", [4.0, 5.0])
+      ]));
+    }).toThrow();
+  });
+
   // Broken: Passing empty index to index_put_ is invalid
   it('can be constructed with single value', function() {
     let tensor = new Torch.Tensor({
@@ -44,6 +148,67 @@ describe('TorchTensor', function() {
     expect(tensor.get_tensor_data().deep_unpack()).toEqual(2.0);
   });
 
+  it('can be constructed from bytes', function() {
+    let data = new Float64Array([1.0, 2.0, 3.0, 4.0]);
+    let bytes = new GLib.Bytes(new Uint8Array(data.buffer));
+    let tensor = Torch.Tensor.new_from_bytes(bytes, GObject.TYPE_DOUBLE, [2, 2], null);
+
+    expect(tensor.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[1.0, 2.0], [3.0, 4.0]]);
+  });
+
+  it('cannot be constructed from bytes smaller than its shape', function() {
+    let data = new Float64Array([1.0, 2.0, 3.0]);
+    let bytes = new GLib.Bytes(new Uint8Array(data.buffer));
+
+    expect(() => {
+      Torch.Tensor.new_from_bytes(bytes, GObject.TYPE_DOUBLE, [2, 2], null);
+    }).toThrow();
+  });
+
+  it('can be constructed as a view over a storage', function() {
+    let data = new Float64Array([1.0, 2.0, 3.0, 4.0, 5.0, 6.0]);
+    let storage = Torch.Storage.new_with_fixed_data(new GLib.Bytes(new Uint8Array(data.buffer)));
+    let first = Torch.Tensor.new_from_storage(storage, 0, [2], null, GObject.TYPE_DOUBLE);
+    let rest = Torch.Tensor.new_from_storage(storage, 2, [2, 2], [1, 2], GObject.TYPE_DOUBLE);
+
+    expect(first.get_tensor_data().deep_unpack()).toEqual([1.0, 2.0]);
+    expect(rest.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[3.0, 5.0], [4.0, 6.0]]);
+  });
+
+  it('cannot be constructed as a view past the end of a storage', function() {
+    let data = new Float64Array([1.0, 2.0, 3.0, 4.0]);
+    let storage = Torch.Storage.new_with_fixed_data(new GLib.Bytes(new Uint8Array(data.buffer)));
+
+    expect(() => {
+      Torch.Tensor.new_from_storage(storage, 2, [3], null, GObject.TYPE_DOUBLE);
+    }).toThrow();
+  });
+
+  it('can get its data as bytes', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 4.0, 4, opts);
+    let bytes = tensor.get_data_bytes();
+
+    expect(Array.from(new Float64Array(bytes.toArray().slice().buffer))).toEqual([1.0, 2.0, 3.0, 4.0]);
+  });
+
+  it('cannot get the data of a non-contiguous tensor as bytes', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 4.0, 4, opts).reshape([2, 2]).t();
+
+    expect(() => {
+      tensor.get_data_bytes();
+    }).toThrow();
+  });
+
+  it('cannot get the data of a tensor with no data as bytes', function() {
+    let tensor = new Torch.Tensor();
+
+    expect(() => {
+      tensor.get_data_bytes();
+    }).toThrow();
+  });
+
   it('can be constructed by Torch.zeros', function() {
     let tensor = Torch.zeros([1], new Torch.TensorOptions({}));
   });
@@ -164,6 +329,82 @@ describe('TorchTensor', function() {
     expect(tensor_indexed.get_tensor_data().deep_unpack()).toEqual([7, 8, 9]);
   });
 
+  it('can get data from a transposed view', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 6.0, 6, opts);
+    let transposed = tensor.reshape([2, 3]).t();
+
+    expect(transposed.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[1, 4], [2, 5], [3, 6]]);
+    expect(transposed.get_flat_variant().deep_unpack()).toEqual(["float64", [3, 2], [1, 4, 2, 5, 3, 6]]);
+  });
+
+  it('can get data from a strided slice', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 10.0, 10, opts);
+    let tensor_reshaped = tensor.reshape([2, 5]);
+    let indices = [Torch.Index.new_none (), Torch.Index.new_range (0, 5, 2)];
+
+    let tensor_indexed = tensor_reshaped.index_list(indices);
+
+    expect(tensor_indexed.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[1, 3, 5], [6, 8, 10]]);
+  });
+
+  it('can write the result of an operation into an existing tensor', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(-2.0, 1.0, 4, opts);
+    let out = Torch.zeros([4], opts);
+
+    expect(Torch.abs_out(out, tensor)).toBe(out);
+    expect(out.get_tensor_data().deep_unpack()).toEqual([2, 1, 0, 1]);
+  });
+
+  it('resizes the destination of an out operation', function() {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 4.0, 4, opts).reshape([2, 2]);
+    let out = Torch.zeros([0], opts);
+
+    Torch.mm_out(out, tensor, tensor);
+
+    expect(out.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[7, 10], [15, 22]]);
+  });
+
+  it('can be copied to a device asynchronously', function(done) {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 3.0, 3, opts);
+    let device = Torch.Device.new_from_string("cpu");
+
+    tensor.copy_to_device_async(device, null, (obj, result) => {
+      let copy = tensor.copy_to_device_finish(result);
+
+      expect(copy.get_tensor_data().deep_unpack()).toEqual([1, 2, 3]);
+      done();
+    });
+  });
+
+  it('can multiply matrices asynchronously', function(done) {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 4.0, 4, opts).reshape([2, 2]);
+
+    tensor.mm_async(tensor, null, (obj, result) => {
+      let product = tensor.mm_finish(result);
+
+      expect(product.get_tensor_data().deep_unpack().map(v => v.deep_unpack())).toEqual([[7, 10], [15, 22]]);
+      done();
+    });
+  });
+
+  it('does not start cancelled asynchronous operations', function(done) {
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 4.0, 4, opts).reshape([2, 2]);
+    let cancellable = new Gio.Cancellable();
+
+    cancellable.cancel();
+    tensor.mm_async(tensor, cancellable, (obj, result) => {
+      expect(() => tensor.mm_finish(result)).toThrowError(/cancel/i);
+      done();
+    });
+  });
+
   /* Skipped, handling of GPtrArray broken on gjs */
   xit('can be array-indexed by ints', function() {
     let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
@@ -0,0 +1,81 @@
+/*
+ * tests/js/torch-gobject/testTensorPool.js
+ *
+ * Tests for the JavaScript Binding to the TensorPool Object.
+ *
+ * Copyright (C) 2021 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+const { GLib, GObject, Torch } = imports.gi;
+
+describe('TorchTensorPool', function() {
+  it('can be constructed', function() {
+    let pool = Torch.TensorPool.new(null);
+  });
+
+  it('acquires tensors of the requested shape', function() {
+    let pool = Torch.TensorPool.new(null);
+    let tensor = pool.acquire([2, 3], GObject.TYPE_DOUBLE);
+
+    expect(tensor.get_dims()).toEqual([2, 3]);
+    expect(tensor.get_dtype()).toEqual(GObject.TYPE_DOUBLE);
+  });
+
+  it('recycles released tensors of the same shape', function() {
+    let pool = Torch.TensorPool.new(null);
+    let tensor = pool.acquire([2, 3], GObject.TYPE_DOUBLE);
+
+    expect(pool.release(tensor)).toBe(true);
+    expect(pool.acquire([2, 3], GObject.TYPE_DOUBLE)).toBe(tensor);
+  });
+
+  it('does not recycle tensors for a different shape', function() {
+    let pool = Torch.TensorPool.new(null);
+    let tensor = pool.acquire([2, 3], GObject.TYPE_DOUBLE);
+
+    pool.release(tensor);
+
+    expect(pool.acquire([3, 2], GObject.TYPE_DOUBLE)).not.toBe(tensor);
+  });
+
+  it('does not recycle views of other tensors', function() {
+    let pool = Torch.TensorPool.new(null);
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE });
+    let tensor = Torch.linspace_double(1.0, 6.0, 6, opts);
+    let view = tensor.reshape([2, 3]);
+
+    expect(pool.release(view)).toBe(false);
+  });
+
+  it('does not take the same tensor twice', function() {
+    let pool = Torch.TensorPool.new(null);
+    let tensor = pool.acquire([2, 3], GObject.TYPE_DOUBLE);
+
+    expect(pool.release(tensor)).toBe(true);
+    expect(pool.release(tensor)).toBe(false);
+    expect(pool.acquire([2, 3], GObject.TYPE_DOUBLE)).toBe(tensor);
+    expect(pool.acquire([2, 3], GObject.TYPE_DOUBLE)).not.toBe(tensor);
+  });
+
+  it('does not recycle tensors which require gradients', function() {
+    let pool = Torch.TensorPool.new(null);
+    let opts = new Torch.TensorOptions({ dtype: GObject.TYPE_DOUBLE, requires_grad: true });
+    let tensor = Torch.ones([2, 3], opts);
+
+    expect(pool.release(tensor)).toBe(false);
+  });
+});
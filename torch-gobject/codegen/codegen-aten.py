@@ -44,6 +44,11 @@ def non_namespaced_function_name(decl):
     if "overload_name" in decl:
         overload_name = decl["overload_name"].lower()
 
+        # The "out" part of the overload name is already implied
+        # by the _out suffix on the function name
+        if is_out_function(decl):
+            overload_name = overload_name.removesuffix("out").rstrip("_")
+
     return "_".join(
         [
             x
@@ -70,6 +75,18 @@ def function_name(decl):
     )
 
 
+def is_output_argument(argument):
+    return argument.get("output", False)
+
+
+def is_out_function(decl):
+    return any(is_output_argument(a) for a in decl["arguments"])
+
+
+def output_arguments(decl):
+    return [a for a in decl["arguments"] if is_output_argument(a)]
+
+
 def unqualified_dynamic_type(type_spec):
     unconst = type_spec.replace("const ", "")
     noqual = unconst.replace("*", "").replace("&", "")
@@ -131,7 +148,11 @@ def type_spec_to_gobject_type(type_spec):
 
 
 def determine_return_transfer_mode(func_decl, return_decl):
-    if (
+    # The return values of _out functions alias the destination
+    # arguments, which are still owned by the caller
+    if is_out_function(func_decl):
+        return "self"
+    elif (
         func_decl["schema_order_arguments"]
         and func_decl["schema_order_arguments"][0]["annotation"] == "a!"
     ):
@@ -157,7 +178,15 @@ def make_gobject_decl(decl):
     ]
 
     gobject_arguments = [
-        type_spec_to_gobject_type(dict(**a, transfer="none")) for a in decl["arguments"]
+        {
+            **type_spec_to_gobject_type(dict(**a, transfer="none")),
+            **(
+                {"desc": "A #{} to write the result into".format(map_type_name(a))}
+                if is_output_argument(a)
+                else {}
+            ),
+        }
+        for a in decl["arguments"]
     ]
 
     # If we return a single pointer-typed value
@@ -184,15 +213,21 @@ def make_gobject_decl(decl):
             "element-type": None,
             "nullable": False,
         }
-        out_arguments = [
-            {
-                **out_arg,
-                "out": True,
-                "type": "{} *".format(out_arg["type"]),
-                "nullable": True,
-            }
-            for out_arg in returns_and_gobject_transfers
-        ]
+        # The destination arguments of _out functions already
+        # give the caller access to the results
+        out_arguments = (
+            []
+            if is_out_function(decl)
+            else [
+                {
+                    **out_arg,
+                    "out": True,
+                    "type": "{} *".format(out_arg["type"]),
+                    "nullable": True,
+                }
+                for out_arg in returns_and_gobject_transfers
+            ]
+        )
 
     # Append an error argument to the parameters
     error_argument = {
@@ -250,6 +285,34 @@ FUNCTION_BLACKLIST = (
 )
 
 
+# Functions that are expensive enough that callers will want to run
+# them without blocking their main loop. These also get generated
+# _async and _finish variants which run on the worker threads.
+COMPUTE_HEAVY_FUNCTIONS = (
+    "addbmm",
+    "addmm",
+    "baddbmm",
+    "bmm",
+    "cdist",
+    "chain_matmul",
+    "cholesky",
+    "conv1d",
+    "conv2d",
+    "conv3d",
+    "conv_transpose1d",
+    "conv_transpose2d",
+    "conv_transpose3d",
+    "convolution",
+    "einsum",
+    "inverse",
+    "kron",
+    "linear",
+    "matmul",
+    "mm",
+    "tensordot",
+)
+
+
 def is_skipped(decl):
     if decl["name"] in FUNCTION_BLACKLIST:
         print("Skipped {decl[name]} - in blacklist".format(decl=decl), file=sys.stderr)
@@ -263,10 +326,6 @@ def is_skipped(decl):
     if decl["name"].startswith("_") and not decl["name"].startswith("__"):
         return True
 
-    # Skip "out" versions
-    if decl["name"].endswith("_out"):
-        return True
-
     if decl["returns"]:
         for return_type_info in decl["returns"]:
             if (
@@ -311,6 +370,283 @@ def rewrite_decl_for_scalar(decl, scalar_type):
     return d
 
 
+def async_capture_for_argument(argument):
+    # The real arguments are converted on the calling thread and then
+    # copied into the closure that runs on the worker thread, so
+    # anything that is only a view of the caller's memory needs
+    # to be copied into an owning container first.
+    #
+    # Returns a tuple of a statement to create the owning copy and
+    # the name to pass to the function, or None if the argument
+    # cannot be captured.
+    unqualified = unqualified_dynamic_type(
+        argument.get("api_dynamic_type", argument["dynamic_type"])
+    )
+    name = "real_" + argument["name"]
+
+    if unqualified in ("at::IntArrayRef", "at::ArrayRef<double>"):
+        if is_nullable(argument):
+            return None
+
+        element_type = "double" if unqualified == "at::ArrayRef<double>" else "long"
+        return (
+            "std::vector <{t}> owned_{a} ({n}.begin (), {n}.end ());".format(
+                t=element_type, a=argument["name"], n=name
+            ),
+            "owned_" + argument["name"],
+        )
+
+    if TYPE_MAPPING[unqualified].get("convert_native_owns_elements", False):
+        if is_nullable(argument):
+            return None
+
+        return ("", name + "_elements")
+
+    if unqualified in ("c10::string_view", "std::string"):
+        if is_nullable(argument):
+            return None
+
+        return (
+            "std::string owned_{a} ({n}.data (), {n}.size ());".format(
+                a=argument["name"], n=name
+            ),
+            "owned_" + argument["name"],
+        )
+
+    return ("", name)
+
+
+def should_generate_async(decl):
+    if decl["name"] not in COMPUTE_HEAVY_FUNCTIONS or is_out_function(decl):
+        return False
+
+    if len(decl["returns"]) != 1:
+        return False
+
+    if unqualified_dynamic_type(decl["returns"][0]["dynamic_type"]) != "at::Tensor":
+        return False
+
+    return all(async_capture_for_argument(a) is not None for a in decl["arguments"])
+
+
+ASYNC_ARGUMENTS = [
+    {
+        "type": "GCancellable *",
+        "name": "cancellable",
+        "nullable": True,
+        "transfer": "none",
+        "element-type": None,
+        "size": None,
+        "desc": "A #GCancellable",
+    },
+    {
+        "type": "GAsyncReadyCallback",
+        "name": "callback",
+        "nullable": False,
+        "transfer": None,
+        "element-type": None,
+        "size": None,
+        "scope": "async",
+        "desc": "A #GAsyncReadyCallback to call when the result is ready",
+    },
+    {
+        "type": "gpointer",
+        "name": "user_data",
+        "nullable": False,
+        "transfer": None,
+        "element-type": None,
+        "size": None,
+        "desc": "Closure data for @callback",
+    },
+]
+
+FINISH_ARGUMENTS = [
+    {
+        "type": "GAsyncResult *",
+        "name": "result",
+        "nullable": False,
+        "transfer": "none",
+        "element-type": None,
+        "size": None,
+        "desc": "A #GAsyncResult",
+    },
+    {
+        "type": "GError **",
+        "name": "error",
+        "nullable": True,
+        "transfer": "full",
+        "element-type": None,
+        "out": True,
+        "size": None,
+        "desc": "An error-out of #GError",
+    },
+]
+
+
+def async_source_object(decl, gobject_decl):
+    # Following the GIO convention, methods use the object they are
+    # called on as the source object of the task, and take it again
+    # in the _finish function.
+    if "Tensor" in decl["method_of"]:
+        return gobject_decl["arguments"][0]
+
+    return None
+
+
+def make_async_gobject_decls(decl, gobject_decl):
+    source_object = async_source_object(decl, gobject_decl)
+    async_decl = {
+        "name": gobject_decl["name"] + "_async",
+        "returns": {
+            "name": "",
+            "type": "void",
+            "size": None,
+            "transfer": "none",
+            "element-type": None,
+            "nullable": False,
+        },
+        "arguments": gobject_decl["arguments"] + ASYNC_ARGUMENTS,
+    }
+    finish_decl = {
+        "name": gobject_decl["name"] + "_finish",
+        "returns": {
+            **gobject_decl["returns"],
+            "desc": "The result of {}() or %NULL with @error set on failure".format(
+                gobject_decl["name"]
+            ),
+        },
+        "arguments": ([source_object] if source_object else []) + FINISH_ARGUMENTS,
+    }
+
+    return async_decl, finish_decl
+
+
+def print_async_function_decls(decl, gobject_decl):
+    for d in make_async_gobject_decls(decl, gobject_decl):
+        print("")
+        print(fmt_gobject_func_fwd_decl(d["name"], d["returns"], d["arguments"]) + ";")
+
+
+def make_async_function_call(decl, gobject_decl, async_decl, source_object_name):
+    captures = [async_capture_for_argument(a) for a in decl["arguments"]]
+    capture_statements = "\n".join([c[0] for c in captures if c[0]])
+    capture_names = [c[1] for c in captures]
+
+    if "namespace" in decl["method_of"]:
+        call = "{namespace}::{name} ({args})".format(
+            namespace=determine_namespace(decl),
+            name=decl["name"],
+            args=", ".join(capture_names),
+        )
+    else:
+        call = "{obj}.{name} ({args})".format(
+            obj=capture_names[0],
+            name=decl["name"],
+            args=", ".join(capture_names[1:]),
+        )
+
+    return "\n".join(
+        [
+            "try",
+            "  {",
+            indent(
+                "\n".join(
+                    [
+                        s
+                        for s in [
+                            make_argument_marshallers(
+                                decl["arguments"], gobject_decl["arguments"]
+                            ),
+                            capture_statements,
+                        ]
+                        if s
+                    ]
+                ),
+                4,
+            ),
+            "",
+            indent(
+                "\n".join(
+                    [
+                        "torch_tensor_run_task_in_worker_thread ({}, cancellable, callback, user_data,".format(
+                            source_object_name
+                        ),
+                        "                                        reinterpret_cast <gpointer> ({}),".format(
+                            async_decl["name"]
+                        ),
+                        "                                        [=]() -> at::Tensor {",
+                        "  return {};".format(call),
+                        "});",
+                    ]
+                ),
+                4,
+            ),
+            "  }",
+            "catch (const std::exception &e)",
+            "  {",
+            indent(
+                "\n".join(
+                    [
+                        "g_task_report_new_error ({}, callback, user_data,".format(
+                            source_object_name
+                        ),
+                        "                         reinterpret_cast <gpointer> ({}),".format(
+                            async_decl["name"]
+                        ),
+                        '                         G_IO_ERROR, G_IO_ERROR_FAILED, "%s", e.what ());',
+                    ]
+                ),
+                4,
+            ),
+            "  }",
+        ]
+    )
+
+
+def print_async_function_bodies(decl, gobject_decl):
+    async_decl, finish_decl = make_async_gobject_decls(decl, gobject_decl)
+    source_object = async_source_object(decl, gobject_decl)
+    source_object_name = source_object["name"] if source_object else "NULL"
+    async_doc = "Run {}() on the worker threads. Call {}() from @callback to get the result.".format(
+        gobject_decl["name"], finish_decl["name"]
+    )
+
+    str_list = [
+        fmt_function_decl_header_comment(
+            async_decl["name"], None, async_decl["arguments"]
+        ).replace(" */", " *\n * {}\n */".format(async_doc)),
+        fmt_gobject_func_fwd_decl(
+            async_decl["name"], async_decl["returns"], async_decl["arguments"]
+        ),
+        "{",
+        indent(
+            make_async_function_call(
+                decl, gobject_decl, async_decl, source_object_name
+            ),
+            4,
+        ),
+        "}",
+        "",
+        fmt_function_decl_header_comment(
+            finish_decl["name"], finish_decl["returns"], finish_decl["arguments"]
+        ),
+        fmt_gobject_func_fwd_decl(
+            finish_decl["name"], finish_decl["returns"], finish_decl["arguments"]
+        ),
+        "{",
+        indent(
+            "return torch_tensor_task_finish (result, {}, reinterpret_cast <gpointer> ({}), error);".format(
+                source_object_name, async_decl["name"]
+            ),
+            4,
+        ),
+        "}",
+    ]
+
+    print("")
+    print("\n".join(str_list))
+
+
 def print_function_decl(decl):
     str_list = []
 
@@ -330,6 +666,9 @@ def print_function_decl(decl):
     print("")
     print("\n".join(str_list))
 
+    if should_generate_async(decl):
+        print_async_function_decls(decl, gobject_decl)
+
 
 def make_argument_marshaller(argument, gobject_argument):
     arg_type = argument.get("api_dynamic_type", argument["dynamic_type"])
@@ -343,6 +682,29 @@ def make_argument_marshaller(argument, gobject_argument):
         [wrapped_type, TYPE_MAPPING[unqualified_arg_type]["convert_native_qualifiers"]]
     )
 
+    # Bind destination tensors by reference so that the callee
+    # writes through to the caller's tensor without an extra handle
+    if is_output_argument(argument) and not is_nullable(argument):
+        wrapped_type = qualified_type.strip()
+
+    # The ArrayRef list types are non-owning views, so the converted
+    # elements need to be kept alive in a local container for the
+    # duration of the call rather than in a temporary.
+    if TYPE_MAPPING[unqualified_arg_type].get(
+        "convert_native_owns_elements", False
+    ) and not is_nullable(argument):
+        return "\n".join(
+            [
+                "auto real_{name}_elements = {conv};".format(
+                    name=argument["name"],
+                    conv=map_type_native_conv(argument)(argument["name"]),
+                ),
+                "{type} real_{name} = real_{name}_elements;".format(
+                    type=wrapped_type, name=argument["name"]
+                ),
+            ]
+        )
+
     return (
         " ".join(
             [
@@ -454,7 +816,18 @@ def make_function_call(decl, gobject_decl):
             ]
         )
 
-    if decl["returns"]:
+    if decl["returns"] and is_out_function(decl):
+        # The results were written into the destination arguments,
+        # so there is nothing to convert. If there is a single
+        # destination, hand it back to make chaining calls easier.
+        convert_statement = ""
+
+        if gobject_decl["return-rv-directly"]:
+            assert len(output_arguments(decl)) == 1
+            return_statement = "return {};".format(output_arguments(decl)[0]["name"])
+        else:
+            return_statement = "return TRUE;"
+    elif decl["returns"]:
         assert len(gobject_decl["out-arguments"]) > 0
 
         if gobject_decl["returns"]["transfer"] == "self":
@@ -602,6 +975,9 @@ def print_function_body(decl):
     print("")
     print("\n".join(str_list))
 
+    if should_generate_async(decl):
+        print_async_function_bodies(decl, gobject_decl)
+
 
 def print_header(declarations):
     print("#include <torch-gobject/torch-allocator.h>")
@@ -613,6 +989,7 @@ def print_header(declarations):
     print("#include <torch-gobject/torch-memory-format.h>")
     print("#include <torch-gobject/torch-tensor.h>")
     print("#include <torch-gobject/torch-tensor-options.h>")
+    print("#include <gio/gio.h>")
     print("")
     print("G_BEGIN_DECLS")
 
@@ -634,6 +1011,7 @@ def print_source(declarations):
     print("#include <torch-gobject/torch-layout-internal.h>")
     print("#include <torch-gobject/torch-memory-format-internal.h>")
     print("#include <torch-gobject/torch-storage-internal.h>")
+    print("#include <torch-gobject/torch-task-internal.h>")
     print("#include <torch-gobject/torch-tensor.h>")
     print("#include <torch-gobject/torch-tensor-internal.h>")
     print("#include <torch-gobject/torch-tensor-options-internal.h>")
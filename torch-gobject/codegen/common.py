@@ -69,6 +69,7 @@ TYPE_MAPPING = {
         "name": "GPtrArray *",
         "meta": {"type": "TorchDimname *"},
         "convert_native_qualifiers": "",
+        "convert_native_owns_elements": True,
         "convert_native_func": lambda a: "torch_dimname_list_from_dimname_ptr_array ({a})".format(
             a=a
         ),
@@ -127,6 +128,7 @@ TYPE_MAPPING = {
         "name": "GPtrArray *",
         "meta": {"type": "TorchTensor *"},
         "convert_native_qualifiers": "",
+        "convert_native_owns_elements": True,
         "convert_native_func": lambda a: "torch_tensor_list_from_tensor_ptr_array ({a})".format(
             a=a
         ),
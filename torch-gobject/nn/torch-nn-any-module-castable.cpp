@@ -25,6 +25,7 @@
 #include <torch-gobject/torch-util.h>
 
 G_DEFINE_INTERFACE (TorchNNAnyModuleCastable, torch_nn_any_module_castable, G_TYPE_OBJECT)
+G_DEFINE_QUARK (torch-nn-any-module-castable-converted, torch_nn_any_module_castable_converted)
 
 static void
 torch_nn_any_module_castable_default_init (TorchNNAnyModuleCastableInterface *castable_iface)
@@ -50,6 +51,49 @@ torch_nn_any_module_castable_convert (TorchNNAnyModuleCastable  *castable,
   return iface->convert (castable, error);
 }
 
+/**
+ * torch_nn_any_module_castable_forward:
+ * @castable: (transfer none): A #TorchNNAnyModuleCastable instance.
+ * @inputs: (element-type TorchTensor): A #GPtrArray of #TorchTensor to
+ *          pass to forward as positional arguments, see
+ *          %torch_nn_any_module_forward.
+ * @error: A #GError
+ *
+ * Run a forward pass of the module underlying @castable. The
+ * #TorchNNAnyModule that @castable is converted to shares the module
+ * with @castable, so it is converted on the first call and kept
+ * around for the following ones.
+ *
+ * Returns: (transfer full): The #TorchTensor returned by forward, or
+ *          %NULL with @error set on failure.
+ */
+TorchTensor *
+torch_nn_any_module_castable_forward (TorchNNAnyModuleCastable  *castable,
+                                      GPtrArray                 *inputs,
+                                      GError                   **error)
+{
+  g_return_val_if_fail (TORCH_IS_NN_ANY_MODULE_CASTABLE (castable), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  TorchNNAnyModule *any_module = static_cast <TorchNNAnyModule *> (g_object_get_qdata (G_OBJECT (castable),
+                                                                                       torch_nn_any_module_castable_converted_quark ()));
+
+  if (any_module == nullptr)
+    {
+      any_module = torch_nn_any_module_castable_convert (castable, error);
+
+      if (any_module == nullptr)
+        return NULL;
+
+      g_object_set_qdata_full (G_OBJECT (castable),
+                               torch_nn_any_module_castable_converted_quark (),
+                               any_module,
+                               g_object_unref);
+    }
+
+  return torch_nn_any_module_forward (any_module, inputs, error);
+}
+
 torch::nn::AnyModule
 torch_nn_any_module_castable_to_real_any_module (TorchNNAnyModuleCastable *castable)
 {
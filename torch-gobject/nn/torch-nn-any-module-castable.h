@@ -40,4 +40,8 @@ struct _TorchNNAnyModuleCastableInterface
 TorchNNAnyModule * torch_nn_any_module_castable_convert (TorchNNAnyModuleCastable  *castable,
                                                          GError                   **error);
 
+TorchTensor * torch_nn_any_module_castable_forward (TorchNNAnyModuleCastable  *castable,
+                                                    GPtrArray                 *inputs,
+                                                    GError                   **error);
+
 G_END_DECLS
\ No newline at end of file
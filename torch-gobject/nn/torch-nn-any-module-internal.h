@@ -36,6 +36,13 @@ TorchNNAnyModule * torch_nn_any_module_convert_from_real_module (T const &real_m
 
 torch::nn::AnyModule & torch_nn_any_module_to_real_any_module (TorchNNAnyModule *any_module);
 
+/* Call forward on @real_module with @inputs as positional arguments.
+ * Trailing arguments that the module has defaults for may be left
+ * out. Throws if the number or types of the arguments do not match
+ * or if the module does not return a single tensor. */
+torch::Tensor torch_nn_any_module_real_forward (torch::nn::AnyModule             &real_module,
+                                                std::vector <torch::Tensor> const &inputs);
+
 namespace torch
 {
   namespace gobject
@@ -23,9 +23,69 @@
 #include <torch-gobject/nn/torch-nn-module-base.h>
 #include <torch-gobject/nn/torch-nn-any-module.h>
 #include <torch-gobject/nn/torch-nn-any-module-internal.h>
+#include <torch-gobject/torch-tensor-internal.h>
+#include <torch-gobject/torch-util.h>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gio/gio.h>
 
 #include <torch/torch.h>
 
+namespace
+{
+  constexpr size_t max_forward_arguments = 8;
+
+  typedef torch::Tensor (*RealForwardFunc) (torch::nn::AnyModule             &,
+                                            std::vector <torch::Tensor> const &);
+
+  template <size_t... I>
+  torch::Tensor
+  real_forward_unpacked (torch::nn::AnyModule              &real_module,
+                         std::vector <torch::Tensor> const &inputs,
+                         std::index_sequence <I...>)
+  {
+    return real_module.any_forward (inputs[I]...).template get <torch::Tensor> ();
+  }
+
+  template <size_t N>
+  torch::Tensor
+  real_forward_with_arity (torch::nn::AnyModule              &real_module,
+                           std::vector <torch::Tensor> const &inputs)
+  {
+    return real_forward_unpacked (real_module, inputs, std::make_index_sequence <N> ());
+  }
+
+  /* AnyModule only takes its arguments as a parameter pack, so
+   * there is one instantiation per number of arguments */
+  RealForwardFunc const real_forward_funcs[max_forward_arguments + 1] = {
+    real_forward_with_arity <0>,
+    real_forward_with_arity <1>,
+    real_forward_with_arity <2>,
+    real_forward_with_arity <3>,
+    real_forward_with_arity <4>,
+    real_forward_with_arity <5>,
+    real_forward_with_arity <6>,
+    real_forward_with_arity <7>,
+    real_forward_with_arity <8>
+  };
+
+  RealForwardFunc
+  lookup_real_forward_func (size_t n_arguments)
+  {
+    if (n_arguments > max_forward_arguments)
+      throw std::invalid_argument ("Modules can be called with at most " +
+                                   std::to_string (max_forward_arguments) +
+                                   " arguments, got " +
+                                   std::to_string (n_arguments));
+
+    return real_forward_funcs[n_arguments];
+  }
+}
+
 struct _TorchNNAnyModule
 {
   TorchNNModuleBase parent_instance;
@@ -35,11 +95,20 @@ typedef struct _TorchNNAnyModulePrivate
 {
   /* We only support keeping the type-erased module with runtime checks */
   torch::nn::AnyModule *internal;
+  gboolean              inference_mode;
 } TorchNNAnyModulePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (TorchNNAnyModule, torch_nn_any_module, TORCH_TYPE_NN_MODULE_BASE)
 #define TORCH_NN_ANY_MODULE_GET_PRIVATE(x) static_cast <TorchNNAnyModulePrivate *> (torch_nn_any_module_get_instance_private ((x)))
 
+enum {
+  PROP_0,
+  PROP_INFERENCE_MODE,
+  NPROPS
+};
+
+static GParamSpec *torch_nn_any_module_props [NPROPS] = { NULL, };
+
 torch::nn::AnyModule &
 torch_nn_any_module_to_real_any_module (TorchNNAnyModule *nn_module)
 {
@@ -58,11 +127,181 @@ torch_nn_any_module_new_from_real_any_module (torch::nn::AnyModule const &real_m
   return mod;
 }
 
+torch::Tensor
+torch_nn_any_module_real_forward (torch::nn::AnyModule              &real_module,
+                                  std::vector <torch::Tensor> const &inputs)
+{
+  return lookup_real_forward_func (inputs.size ()) (real_module, inputs);
+}
+
+/**
+ * torch_nn_any_module_forward:
+ * @nn_module: A #TorchNNAnyModule
+ * @inputs: (element-type TorchTensor): A #GPtrArray of #TorchTensor to
+ *          pass to forward as positional arguments. Elements may be
+ *          %NULL to pass an empty tensor, for instance to skip an
+ *          optional mask, and trailing arguments which have defaults
+ *          may be left out.
+ * @error: A #GError
+ *
+ * Run a forward pass of the module wrapped by @nn_module. If
+ * #TorchNNAnyModule:inference-mode is set, the pass runs in inference
+ * mode, otherwise it runs in whatever mode the calling thread is in.
+ *
+ * Returns: (transfer full): The #TorchTensor returned by forward, or
+ *          %NULL with @error set on failure.
+ */
+TorchTensor *
+torch_nn_any_module_forward (TorchNNAnyModule  *nn_module,
+                             GPtrArray         *inputs,
+                             GError           **error)
+{
+  TorchNNAnyModulePrivate *priv = TORCH_NN_ANY_MODULE_GET_PRIVATE (nn_module);
+
+  g_return_val_if_fail (TORCH_IS_NN_ANY_MODULE (nn_module), NULL);
+  g_return_val_if_fail (inputs != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (priv->internal == nullptr)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_INITIALIZED,
+                   "This TorchNNAnyModule does not hold a module");
+      return NULL;
+    }
+
+  try
+    {
+      std::vector <torch::Tensor> real_inputs;
+
+      real_inputs.reserve (inputs->len);
+
+      for (guint i = 0; i < inputs->len; ++i)
+        {
+          TorchTensor *input = static_cast <TorchTensor *> (g_ptr_array_index (inputs, i));
+
+          real_inputs.push_back (input != NULL ? torch_tensor_get_real_tensor (input) : torch::Tensor ());
+        }
+
+      /* Only enter inference mode here, rather than also leaving it
+       * when the property is unset, so that a scope entered by the
+       * caller still applies */
+      c10::optional <c10::InferenceMode> inference_mode_guard;
+
+      if (priv->inference_mode)
+        inference_mode_guard.emplace ();
+
+      return torch_tensor_new_from_real_tensor (torch_nn_any_module_real_forward (*priv->internal, real_inputs));
+    }
+  catch (std::invalid_argument const &e)
+    {
+      return reinterpret_cast <TorchTensor *> (set_error_from_exception (e,
+                                                                         G_IO_ERROR,
+                                                                         G_IO_ERROR_INVALID_ARGUMENT,
+                                                                         error));
+    }
+  catch (std::exception const &e)
+    {
+      return reinterpret_cast <TorchTensor *> (set_error_from_exception (e,
+                                                                         G_IO_ERROR,
+                                                                         G_IO_ERROR_FAILED,
+                                                                         error));
+    }
+}
+
+/**
+ * torch_nn_any_module_get_inference_mode:
+ * @nn_module: A #TorchNNAnyModule
+ *
+ * Get whether forward passes of @nn_module run in inference mode.
+ *
+ * Returns: The value of #TorchNNAnyModule:inference-mode.
+ */
+gboolean
+torch_nn_any_module_get_inference_mode (TorchNNAnyModule *nn_module)
+{
+  TorchNNAnyModulePrivate *priv = TORCH_NN_ANY_MODULE_GET_PRIVATE (nn_module);
+
+  g_return_val_if_fail (TORCH_IS_NN_ANY_MODULE (nn_module), FALSE);
+
+  return priv->inference_mode;
+}
+
+/**
+ * torch_nn_any_module_set_inference_mode:
+ * @nn_module: A #TorchNNAnyModule
+ * @inference_mode: Whether to run forward passes in inference mode.
+ *
+ * Set whether forward passes of @nn_module run in inference mode, see
+ * %torch_inference_mode_enter. This is meant for modules that are
+ * only used for serving, since the outputs cannot be used to compute
+ * gradients.
+ *
+ * A #TorchNNWorkerPool or #TorchNNBatcher uses the value at the time
+ * it was created.
+ */
+void
+torch_nn_any_module_set_inference_mode (TorchNNAnyModule *nn_module,
+                                        gboolean          inference_mode)
+{
+  TorchNNAnyModulePrivate *priv = TORCH_NN_ANY_MODULE_GET_PRIVATE (nn_module);
+
+  g_return_if_fail (TORCH_IS_NN_ANY_MODULE (nn_module));
+
+  inference_mode = !!inference_mode;
+
+  if (priv->inference_mode == inference_mode)
+    return;
+
+  priv->inference_mode = inference_mode;
+  g_object_notify_by_pspec (G_OBJECT (nn_module), torch_nn_any_module_props[PROP_INFERENCE_MODE]);
+}
+
 static void
 torch_nn_any_module_init (TorchNNAnyModule *nn_module)
 {
   TorchNNAnyModulePrivate *priv = TORCH_NN_ANY_MODULE_GET_PRIVATE (nn_module);
   priv->internal = nullptr;
+  priv->inference_mode = FALSE;
+}
+
+static void
+torch_nn_any_module_get_property (GObject      *object,
+                                  unsigned int  prop_id,
+                                  GValue       *value,
+                                  GParamSpec   *pspec)
+{
+  TorchNNAnyModule *nn_module = TORCH_NN_ANY_MODULE (object);
+
+  switch (prop_id)
+    {
+      case PROP_INFERENCE_MODE:
+        g_value_set_boolean (value, torch_nn_any_module_get_inference_mode (nn_module));
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_nn_any_module_set_property (GObject      *object,
+                                  unsigned int  prop_id,
+                                  const GValue *value,
+                                  GParamSpec   *pspec)
+{
+  TorchNNAnyModule *nn_module = TORCH_NN_ANY_MODULE (object);
+
+  switch (prop_id)
+    {
+      case PROP_INFERENCE_MODE:
+        torch_nn_any_module_set_inference_mode (nn_module, g_value_get_boolean (value));
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
 }
 
 static void
@@ -76,6 +315,8 @@ torch_nn_any_module_finalize (GObject *object)
       delete priv->internal;
       priv->internal = nullptr;
     }
+
+  G_OBJECT_CLASS (torch_nn_any_module_parent_class)->finalize (object);
 }
 
 static void
@@ -83,7 +324,20 @@ torch_nn_any_module_class_init (TorchNNAnyModuleClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->get_property = torch_nn_any_module_get_property;
+  object_class->set_property = torch_nn_any_module_set_property;
   object_class->finalize = torch_nn_any_module_finalize;
+
+  torch_nn_any_module_props[PROP_INFERENCE_MODE] =
+    g_param_spec_boolean ("inference-mode",
+                          "Inference Mode",
+                          "Whether forward passes run in inference mode, without autograd bookkeeping",
+                          FALSE,
+                          static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY));
+
+  g_object_class_install_properties (object_class,
+                                     NPROPS,
+                                     torch_nn_any_module_props);
 }
 
 TorchNNAnyModule *
@@ -24,10 +24,20 @@
 
 #include <glib-object.h>
 #include <torch-gobject/nn/torch-nn-module-base.h>
+#include <torch-gobject/torch-tensor.h>
 
 G_BEGIN_DECLS
 
 #define TORCH_TYPE_NN_ANY_MODULE torch_nn_any_module_get_type ()
 G_DECLARE_FINAL_TYPE (TorchNNAnyModule, torch_nn_any_module, TORCH, NN_ANY_MODULE, TorchNNModuleBase)
 
+gboolean torch_nn_any_module_get_inference_mode (TorchNNAnyModule *nn_module);
+
+void torch_nn_any_module_set_inference_mode (TorchNNAnyModule *nn_module,
+                                             gboolean          inference_mode);
+
+TorchTensor * torch_nn_any_module_forward (TorchNNAnyModule  *nn_module,
+                                           GPtrArray         *inputs,
+                                           GError           **error);
+
 G_END_DECLS
\ No newline at end of file
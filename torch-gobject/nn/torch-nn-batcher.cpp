@@ -0,0 +1,764 @@
+/*
+ * torch-gobject/nn/torch-nn-batcher.cpp
+ *
+ * Coalesce single-sample forward requests into batches.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <gio/gio.h>
+
+#include <torch-gobject/nn/torch-nn-any-module.h>
+#include <torch-gobject/nn/torch-nn-any-module-internal.h>
+#include <torch-gobject/nn/torch-nn-batcher.h>
+#include <torch-gobject/torch-runtime-internal.h>
+#include <torch-gobject/torch-tensor-internal.h>
+#include <torch-gobject/torch-util.h>
+
+#include <torch/torch.h>
+
+struct _TorchNNBatcher
+{
+  GObject parent_instance;
+};
+
+namespace
+{
+  struct BatcherRequest
+  {
+    GTask         *task;
+    torch::Tensor  input;
+  };
+
+  /* Pushed onto the queue to tell the scheduler thread to exit */
+  BatcherRequest stop_request;
+
+  /* Bucket 0 counts a depth of zero, bucket i counts depths in
+   * [2^(i - 1), 2^i) */
+  constexpr guint n_queue_depth_buckets = 33;
+
+  struct BatcherState
+  {
+    GAsyncQueue          *queue;
+    torch::nn::AnyModule  module;
+    guint                 max_batch_size;
+    gint64                max_wait_time;
+    guint                 batch_dim;
+    gint                  padding_mask_argument;
+    double                padding_value;
+    bool                  inference_mode;
+
+    GMutex                stats_mutex;
+    std::vector <guint64> batch_size_histogram;
+    std::vector <guint64> queue_depth_histogram;
+
+    BatcherState (torch::nn::AnyModule const &module,
+                  guint                       max_batch_size,
+                  gint64                      max_wait_time,
+                  guint                       batch_dim,
+                  gint                        padding_mask_argument,
+                  double                      padding_value,
+                  bool                        inference_mode) :
+      queue (g_async_queue_new ()),
+      module (module),
+      max_batch_size (max_batch_size),
+      max_wait_time (max_wait_time),
+      batch_dim (batch_dim),
+      padding_mask_argument (padding_mask_argument),
+      padding_value (padding_value),
+      inference_mode (inference_mode),
+      batch_size_histogram (max_batch_size, 0),
+      queue_depth_histogram (n_queue_depth_buckets, 0)
+    {
+      g_mutex_init (&stats_mutex);
+    }
+
+    ~BatcherState ()
+    {
+      g_async_queue_unref (queue);
+      g_mutex_clear (&stats_mutex);
+    }
+
+    void record_batch (size_t batch_size,
+                       guint  queue_depth)
+    {
+      g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&stats_mutex);
+
+      ++batch_size_histogram[batch_size - 1];
+      ++queue_depth_histogram[queue_depth == 0 ? 0 : g_bit_storage (queue_depth)];
+    }
+  };
+
+  void
+  return_request_error (BatcherRequest *request,
+                        GQuark          domain,
+                        gint            code,
+                        const char     *message)
+  {
+    g_task_return_new_error (request->task, domain, code, "%s", message);
+  }
+
+  bool
+  has_same_trailing_shape (torch::Tensor const &a,
+                           torch::Tensor const &b)
+  {
+    return a.dim () == b.dim () &&
+           a.scalar_type () == b.scalar_type () &&
+           a.device () == b.device () &&
+           std::equal (a.sizes ().begin () + 1, a.sizes ().end (), b.sizes ().begin () + 1);
+  }
+
+  /* Stack the requests along batch_dim, padding dimension 0 of each
+   * sample up to the longest one. The padding mask has a row for each
+   * sample which is true where the sample was padded, matching
+   * src_key_padding_mask of the transformer layers. */
+  void
+  run_batch (BatcherState                  *state,
+             std::vector <BatcherRequest *> &requests)
+  {
+    c10::InferenceMode   inference_mode_guard (state->inference_mode);
+    torch::Tensor const &first = requests.front ()->input;
+    int64_t              n_samples = static_cast <int64_t> (requests.size ());
+    int64_t              max_length = 0;
+    bool                 needs_padding = false;
+
+    for (BatcherRequest *request : requests)
+      max_length = std::max (max_length, request->input.size (0));
+
+    std::vector <int64_t> batch_sizes (first.sizes ().begin (), first.sizes ().end ());
+    batch_sizes[0] = max_length;
+    batch_sizes.insert (batch_sizes.begin () + state->batch_dim, n_samples);
+
+    torch::Tensor batch = torch::full (batch_sizes, state->padding_value, first.options ());
+    torch::Tensor padding_mask = torch::zeros ({ n_samples, max_length },
+                                               torch::TensorOptions ().dtype (torch::kBool).device (first.device ()));
+
+    for (int64_t i = 0; i < n_samples; ++i)
+      {
+        torch::Tensor const &input = requests[i]->input;
+        int64_t              length = input.size (0);
+
+        batch.select (state->batch_dim, i).narrow (0, 0, length).copy_ (input);
+
+        if (length < max_length)
+          {
+            padding_mask[i].narrow (0, length, max_length - length).fill_ (true);
+            needs_padding = true;
+          }
+      }
+
+    std::vector <torch::Tensor> arguments = { batch };
+
+    /* Leaving the mask out when nothing was padded lets the module
+     * skip the masking altogether */
+    if (state->padding_mask_argument >= 0 && needs_padding)
+      {
+        arguments.resize (state->padding_mask_argument + 1);
+        arguments[state->padding_mask_argument] = padding_mask;
+      }
+
+    torch::Tensor output = torch_nn_any_module_real_forward (state->module, arguments);
+
+    if (output.dim () <= state->batch_dim || output.size (state->batch_dim) != n_samples)
+      throw std::runtime_error ("The module did not return one result per sample along the batch dimension");
+
+    for (int64_t i = 0; i < n_samples; ++i)
+      {
+        torch::Tensor result = output.select (state->batch_dim, i);
+
+        /* Modules that keep the sequence dimension get the padding
+         * trimmed off again, anything else is returned as-is */
+        if (result.dim () > 0 && result.size (0) == max_length)
+          result = result.narrow (0, 0, requests[i]->input.size (0));
+
+        g_task_return_pointer (requests[i]->task,
+                               torch_tensor_new_from_real_tensor (result),
+                               g_object_unref);
+      }
+  }
+
+  void
+  dispatch_batch (BatcherState                  *state,
+                  std::vector <BatcherRequest *> &pending)
+  {
+    std::vector <BatcherRequest *> requests;
+
+    requests.reserve (pending.size ());
+
+    for (BatcherRequest *request : pending)
+      {
+        if (g_task_return_error_if_cancelled (request->task))
+          continue;
+
+        if (!requests.empty () && !has_same_trailing_shape (request->input, requests.front ()->input))
+          {
+            return_request_error (request,
+                                  G_IO_ERROR,
+                                  G_IO_ERROR_INVALID_ARGUMENT,
+                                  "Input does not have the same type and trailing dimensions as the rest of the batch");
+            continue;
+          }
+
+        requests.push_back (request);
+      }
+
+    if (!requests.empty ())
+      {
+        try
+          {
+            run_batch (state, requests);
+          }
+        catch (std::exception const &e)
+          {
+            for (BatcherRequest *request : requests)
+              return_request_error (request, G_IO_ERROR, G_IO_ERROR_FAILED, e.what ());
+          }
+      }
+
+    for (BatcherRequest *request : pending)
+      {
+        g_object_unref (request->task);
+        delete request;
+      }
+
+    pending.clear ();
+  }
+
+  gpointer
+  run_scheduler (gpointer data)
+  {
+    std::unique_ptr <std::shared_ptr <BatcherState>> state_ref (static_cast <std::shared_ptr <BatcherState> *> (data));
+    BatcherState                   *state = state_ref->get ();
+    std::vector <BatcherRequest *>  pending;
+    bool                            stopping = false;
+
+    pending.reserve (state->max_batch_size);
+
+    while (!stopping)
+      {
+        BatcherRequest *request = static_cast <BatcherRequest *> (g_async_queue_pop (state->queue));
+
+        if (request == &stop_request)
+          break;
+
+        guint  queue_depth = g_async_queue_length (state->queue) + 1;
+        gint64 deadline = g_get_monotonic_time () + state->max_wait_time;
+
+        pending.push_back (request);
+
+        /* Wait for more requests until the batch is full or the first
+         * request has waited for max-wait-time */
+        while (pending.size () < state->max_batch_size)
+          {
+            gint64 remaining = deadline - g_get_monotonic_time ();
+
+            request = static_cast <BatcherRequest *> (remaining > 0 ?
+                                                      g_async_queue_timeout_pop (state->queue, remaining) :
+                                                      g_async_queue_try_pop (state->queue));
+
+            if (request == NULL)
+              break;
+
+            if (request == &stop_request)
+              {
+                stopping = true;
+                break;
+              }
+
+            pending.push_back (request);
+          }
+
+        state->record_batch (pending.size (), queue_depth);
+        torch_runtime_apply_cpu_affinity_to_current_thread ();
+        dispatch_batch (state, pending);
+      }
+
+    BatcherRequest *request;
+
+    while ((request = static_cast <BatcherRequest *> (g_async_queue_try_pop (state->queue))) != NULL)
+      {
+        if (request == &stop_request)
+          continue;
+
+        return_request_error (request, G_IO_ERROR, G_IO_ERROR_CANCELLED, "The batcher was shut down");
+        g_object_unref (request->task);
+        delete request;
+      }
+
+    return NULL;
+  }
+
+  GArray *
+  histogram_to_array (std::vector <guint64> const &histogram)
+  {
+    GArray *array = g_array_sized_new (FALSE, FALSE, sizeof (guint64), histogram.size ());
+
+    g_array_append_vals (array, histogram.data (), histogram.size ());
+    return array;
+  }
+}
+
+typedef struct _TorchNNBatcherPrivate
+{
+  TorchNNAnyModule *module;
+  guint             max_batch_size;
+  guint64           max_wait_time;
+  guint             batch_dim;
+  gint              padding_mask_argument;
+  double            padding_value;
+
+  /* The scheduler thread holds its own reference on the state, see
+   * torch_nn_batcher_dispose */
+  std::shared_ptr <BatcherState> state;
+  GThread          *scheduler;
+} TorchNNBatcherPrivate;
+
+static void initable_iface_init (GInitableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TorchNNBatcher, torch_nn_batcher, G_TYPE_OBJECT,
+                         G_ADD_PRIVATE (TorchNNBatcher)
+                         G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, initable_iface_init))
+#define TORCH_NN_BATCHER_GET_PRIVATE(a) static_cast <TorchNNBatcherPrivate *> (torch_nn_batcher_get_instance_private ((a)))
+
+enum {
+  PROP_0,
+  PROP_MODULE,
+  PROP_MAX_BATCH_SIZE,
+  PROP_MAX_WAIT_TIME,
+  PROP_BATCH_DIM,
+  PROP_PADDING_MASK_ARGUMENT,
+  PROP_PADDING_VALUE,
+  NPROPS
+};
+
+static GParamSpec *torch_nn_batcher_props [NPROPS] = { NULL, };
+
+/**
+ * torch_nn_batcher_forward_async:
+ * @batcher: A #TorchNNBatcher
+ * @input: A #TorchTensor holding a single sample, without a batch
+ *         dimension. Dimension 0 may differ between samples and is
+ *         padded to the longest sample in the batch.
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call with the result.
+ * @user_data: The data to pass to @callback.
+ *
+ * Queue @input to be run through the module as part of the next
+ * batch. Cancelling @cancellable only has an effect if the batch has
+ * not started running yet.
+ */
+void
+torch_nn_batcher_forward_async (TorchNNBatcher      *batcher,
+                                TorchTensor         *input,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+  g_autoptr (GTask)      task = NULL;
+  g_autoptr (GError)     error = NULL;
+
+  g_return_if_fail (TORCH_IS_NN_BATCHER (batcher));
+  g_return_if_fail (TORCH_IS_TENSOR (input));
+
+  task = g_task_new (batcher, cancellable, callback, user_data);
+  g_task_set_source_tag (task, reinterpret_cast <gpointer> (torch_nn_batcher_forward_async));
+
+  BatcherRequest *request = call_set_error_on_exception (&error, G_IO_ERROR, G_IO_ERROR_FAILED, static_cast <BatcherRequest *> (nullptr), [&]() -> BatcherRequest * {
+    torch::Tensor &real_input = torch_tensor_get_real_tensor (input);
+
+    if (real_input.dim () == 0)
+      throw std::invalid_argument ("Batched inputs must have at least one dimension");
+
+    return new BatcherRequest { static_cast <GTask *> (g_object_ref (task)), real_input };
+  });
+
+  if (request == NULL)
+    {
+      g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&error)));
+      return;
+    }
+
+  g_async_queue_push (priv->state->queue, request);
+}
+
+/**
+ * torch_nn_batcher_forward_finish:
+ * @batcher: A #TorchNNBatcher
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %torch_nn_batcher_forward_async.
+ *
+ * Returns: (transfer full): The slice of the batched output that
+ *          belongs to the input, with the padding removed, or %NULL
+ *          with @error set on failure.
+ */
+TorchTensor *
+torch_nn_batcher_forward_finish (TorchNNBatcher  *batcher,
+                                 GAsyncResult    *result,
+                                 GError         **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, batcher), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        reinterpret_cast <gpointer> (torch_nn_batcher_forward_async), NULL);
+
+  return static_cast <TorchTensor *> (g_task_propagate_pointer (G_TASK (result), error));
+}
+
+/**
+ * torch_nn_batcher_get_batch_size_histogram:
+ * @batcher: A #TorchNNBatcher
+ *
+ * Get how often batches of each size were run. Element i of the
+ * returned array is the number of batches with i + 1 requests.
+ *
+ * Returns: (transfer full) (element-type guint64): A #GArray with
+ *          #TorchNNBatcher:max-batch-size counts.
+ */
+GArray *
+torch_nn_batcher_get_batch_size_histogram (TorchNNBatcher *batcher)
+{
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  g_return_val_if_fail (TORCH_IS_NN_BATCHER (batcher), NULL);
+
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&priv->state->stats_mutex);
+  return histogram_to_array (priv->state->batch_size_histogram);
+}
+
+/**
+ * torch_nn_batcher_get_queue_depth_histogram:
+ * @batcher: A #TorchNNBatcher
+ *
+ * Get how many requests were queued each time a batch was started,
+ * in power of two buckets. Element 0 of the returned array counts
+ * an empty queue and element i counts depths from 2^(i - 1) up to
+ * but not including 2^i.
+ *
+ * Returns: (transfer full) (element-type guint64): A #GArray with
+ *          33 counts.
+ */
+GArray *
+torch_nn_batcher_get_queue_depth_histogram (TorchNNBatcher *batcher)
+{
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  g_return_val_if_fail (TORCH_IS_NN_BATCHER (batcher), NULL);
+
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&priv->state->stats_mutex);
+  return histogram_to_array (priv->state->queue_depth_histogram);
+}
+
+/**
+ * torch_nn_batcher_reset_histograms:
+ * @batcher: A #TorchNNBatcher
+ *
+ * Set all the counts in the batch size and queue depth histograms
+ * back to zero.
+ */
+void
+torch_nn_batcher_reset_histograms (TorchNNBatcher *batcher)
+{
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  g_return_if_fail (TORCH_IS_NN_BATCHER (batcher));
+
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&priv->state->stats_mutex);
+  std::fill (priv->state->batch_size_histogram.begin (), priv->state->batch_size_histogram.end (), 0);
+  std::fill (priv->state->queue_depth_histogram.begin (), priv->state->queue_depth_histogram.end (), 0);
+}
+
+static gboolean
+torch_nn_batcher_initable_init (GInitable     *initable,
+                                GCancellable  *cancellable,
+                                GError       **error)
+{
+  TorchNNBatcher        *batcher = TORCH_NN_BATCHER (initable);
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  if (priv->scheduler != NULL)
+    return TRUE;
+
+  if (priv->module == NULL)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   "A TorchNNBatcher needs a module to run the batches through");
+      return FALSE;
+    }
+
+  if (!call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, FALSE, [&]() -> gboolean {
+        /* The copy shares the underlying module, so calling forward on
+         * the module from another thread while the batcher is running
+         * is not safe */
+        priv->state = std::make_shared <BatcherState> (torch_nn_any_module_to_real_any_module (priv->module),
+                                                       priv->max_batch_size,
+                                                       static_cast <gint64> (priv->max_wait_time),
+                                                       priv->batch_dim,
+                                                       priv->padding_mask_argument,
+                                                       priv->padding_value,
+                                                       torch_nn_any_module_get_inference_mode (priv->module));
+        return TRUE;
+      }))
+    return FALSE;
+
+  std::shared_ptr <BatcherState> *scheduler_state = new std::shared_ptr <BatcherState> (priv->state);
+
+  priv->scheduler = g_thread_try_new ("torch-nn-batcher", run_scheduler, scheduler_state, error);
+
+  if (priv->scheduler == NULL)
+    {
+      delete scheduler_state;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+initable_iface_init (GInitableIface *iface)
+{
+  iface->init = torch_nn_batcher_initable_init;
+}
+
+static void
+torch_nn_batcher_init (TorchNNBatcher *batcher)
+{
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  new (&priv->state) std::shared_ptr <BatcherState> ();
+  priv->scheduler = NULL;
+}
+
+static void
+torch_nn_batcher_get_property (GObject      *object,
+                               unsigned int  prop_id,
+                               GValue       *value,
+                               GParamSpec   *pspec)
+{
+  TorchNNBatcher *batcher = TORCH_NN_BATCHER (object);
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  switch (prop_id)
+    {
+      case PROP_MODULE:
+        g_value_set_object (value, priv->module);
+        break;
+      case PROP_MAX_BATCH_SIZE:
+        g_value_set_uint (value, priv->max_batch_size);
+        break;
+      case PROP_MAX_WAIT_TIME:
+        g_value_set_uint64 (value, priv->max_wait_time);
+        break;
+      case PROP_BATCH_DIM:
+        g_value_set_uint (value, priv->batch_dim);
+        break;
+      case PROP_PADDING_MASK_ARGUMENT:
+        g_value_set_int (value, priv->padding_mask_argument);
+        break;
+      case PROP_PADDING_VALUE:
+        g_value_set_double (value, priv->padding_value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_nn_batcher_set_property (GObject      *object,
+                               unsigned int  prop_id,
+                               const GValue *value,
+                               GParamSpec   *pspec)
+{
+  TorchNNBatcher *batcher = TORCH_NN_BATCHER (object);
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  /* Properties only get set on construction */
+  switch (prop_id)
+    {
+      case PROP_MODULE:
+        priv->module = static_cast <TorchNNAnyModule *> (g_value_dup_object (value));
+        break;
+      case PROP_MAX_BATCH_SIZE:
+        priv->max_batch_size = g_value_get_uint (value);
+        break;
+      case PROP_MAX_WAIT_TIME:
+        priv->max_wait_time = g_value_get_uint64 (value);
+        break;
+      case PROP_BATCH_DIM:
+        priv->batch_dim = g_value_get_uint (value);
+        break;
+      case PROP_PADDING_MASK_ARGUMENT:
+        priv->padding_mask_argument = g_value_get_int (value);
+        break;
+      case PROP_PADDING_VALUE:
+        priv->padding_value = g_value_get_double (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_nn_batcher_dispose (GObject *object)
+{
+  TorchNNBatcher *batcher = TORCH_NN_BATCHER (object);
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  if (priv->scheduler != NULL)
+    {
+      GThread *scheduler = static_cast <GThread *> (g_steal_pointer (&priv->scheduler));
+
+      g_async_queue_push (priv->state->queue, &stop_request);
+
+      /* The scheduler drops its reference on the task of each request
+       * it ran, which can be the last reference on the batcher. It
+       * cannot join itself, but it holds its own reference on the
+       * state, so it is safe to let it finish detached. */
+      if (scheduler == g_thread_self ())
+        g_thread_unref (scheduler);
+      else
+        g_thread_join (scheduler);
+    }
+
+  g_clear_object (&priv->module);
+
+  G_OBJECT_CLASS (torch_nn_batcher_parent_class)->dispose (object);
+}
+
+static void
+torch_nn_batcher_finalize (GObject *object)
+{
+  TorchNNBatcher *batcher = TORCH_NN_BATCHER (object);
+  TorchNNBatcherPrivate *priv = TORCH_NN_BATCHER_GET_PRIVATE (batcher);
+
+  priv->state.~shared_ptr ();
+
+  G_OBJECT_CLASS (torch_nn_batcher_parent_class)->finalize (object);
+}
+
+static void
+torch_nn_batcher_class_init (TorchNNBatcherClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = torch_nn_batcher_get_property;
+  object_class->set_property = torch_nn_batcher_set_property;
+  object_class->dispose = torch_nn_batcher_dispose;
+  object_class->finalize = torch_nn_batcher_finalize;
+
+  torch_nn_batcher_props[PROP_MODULE] =
+    g_param_spec_object ("module",
+                         "Module",
+                         "TorchNNAnyModule to run the batches through",
+                         TORCH_TYPE_NN_ANY_MODULE,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_nn_batcher_props[PROP_MAX_BATCH_SIZE] =
+    g_param_spec_uint ("max-batch-size",
+                       "Max Batch Size",
+                       "Maximum number of requests run in one forward pass",
+                       1,
+                       G_MAXUINT16,
+                       32,
+                       static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_nn_batcher_props[PROP_MAX_WAIT_TIME] =
+    g_param_spec_uint64 ("max-wait-time",
+                         "Max Wait Time",
+                         "Maximum time in microseconds that a request waits for the batch to fill up",
+                         0,
+                         G_MAXINT64,
+                         2000,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_nn_batcher_props[PROP_BATCH_DIM] =
+    g_param_spec_uint ("batch-dim",
+                       "Batch Dimension",
+                       "Dimension that samples are stacked along, 1 for the sequence-first layout of the transformer layers",
+                       0,
+                       1,
+                       1,
+                       static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_nn_batcher_props[PROP_PADDING_MASK_ARGUMENT] =
+    g_param_spec_int ("padding-mask-argument",
+                      "Padding Mask Argument",
+                      "Position of the key padding mask in the arguments to forward, or -1 to not pass one",
+                      -1,
+                      7,
+                      2,
+                      static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_nn_batcher_props[PROP_PADDING_VALUE] =
+    g_param_spec_double ("padding-value",
+                         "Padding Value",
+                         "Value that shorter samples are padded with",
+                         -G_MAXDOUBLE,
+                         G_MAXDOUBLE,
+                         0.0,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_properties (object_class,
+                                     NPROPS,
+                                     torch_nn_batcher_props);
+}
+
+/**
+ * torch_nn_batcher_new:
+ * @module: A #TorchNNAnyModule to run the batches through.
+ * @max_batch_size: The maximum number of requests in a batch.
+ * @max_wait_time: The maximum time in microseconds that a request
+ *                 waits for other requests to join its batch.
+ * @error: A #GError
+ *
+ * Create a new #TorchNNBatcher, which collects single-sample requests
+ * from %torch_nn_batcher_forward_async into batches and runs each
+ * batch through @module with one forward pass on a scheduler thread.
+ *
+ * By default the batcher is set up for #TorchNNTransformerEncoderLayer:
+ * samples of shape (S, E) are padded to the longest S in the batch,
+ * stacked into (S, N, E), and a matching src_key_padding_mask is
+ * passed as the third argument. See the #TorchNNBatcher:batch-dim and
+ * #TorchNNBatcher:padding-mask-argument properties for other modules.
+ *
+ * Returns: (transfer full): A new #TorchNNBatcher or %NULL with
+ *          @error set on failure.
+ */
+TorchNNBatcher *
+torch_nn_batcher_new (TorchNNAnyModule  *module,
+                      guint              max_batch_size,
+                      guint64            max_wait_time,
+                      GError           **error)
+{
+  return static_cast <TorchNNBatcher *> (g_initable_new (TORCH_TYPE_NN_BATCHER,
+                                                         NULL,
+                                                         error,
+                                                         "module", module,
+                                                         "max-batch-size", max_batch_size,
+                                                         "max-wait-time", max_wait_time,
+                                                         NULL));
+}
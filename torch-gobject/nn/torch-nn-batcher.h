@@ -0,0 +1,57 @@
+/*
+ * torch-gobject/nn/torch-nn-batcher.h
+ *
+ * Coalesce single-sample forward requests into batches.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <glib-object.h>
+
+#include <torch-gobject/nn/torch-nn-any-module.h>
+#include <torch-gobject/torch-tensor.h>
+
+G_BEGIN_DECLS
+
+#define TORCH_TYPE_NN_BATCHER torch_nn_batcher_get_type ()
+G_DECLARE_FINAL_TYPE (TorchNNBatcher, torch_nn_batcher, TORCH, NN_BATCHER, GObject)
+
+TorchNNBatcher * torch_nn_batcher_new (TorchNNAnyModule  *module,
+                                       guint              max_batch_size,
+                                       guint64            max_wait_time,
+                                       GError           **error);
+
+void torch_nn_batcher_forward_async (TorchNNBatcher      *batcher,
+                                     TorchTensor         *input,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data);
+
+TorchTensor * torch_nn_batcher_forward_finish (TorchNNBatcher  *batcher,
+                                               GAsyncResult    *result,
+                                               GError         **error);
+
+GArray * torch_nn_batcher_get_batch_size_histogram (TorchNNBatcher *batcher);
+
+GArray * torch_nn_batcher_get_queue_depth_histogram (TorchNNBatcher *batcher);
+
+void torch_nn_batcher_reset_histograms (TorchNNBatcher *batcher);
+
+G_END_DECLS
@@ -0,0 +1,572 @@
+/*
+ * torch-gobject/nn/torch-nn-worker-pool.cpp
+ *
+ * Run forward passes of a module concurrently on per-thread replicas.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gio/gio.h>
+
+#include <torch-gobject/nn/torch-nn-any-module.h>
+#include <torch-gobject/nn/torch-nn-any-module-internal.h>
+#include <torch-gobject/nn/torch-nn-worker-pool.h>
+#include <torch-gobject/torch-mpmc-queue-internal.h>
+#include <torch-gobject/torch-runtime-internal.h>
+#include <torch-gobject/torch-tensor-internal.h>
+#include <torch-gobject/torch-util.h>
+
+#include <torch/torch.h>
+
+struct _TorchNNWorkerPool
+{
+  GObject parent_instance;
+};
+
+namespace
+{
+  struct WorkerPoolJob
+  {
+    GTask                       *task;
+    std::vector <torch::Tensor>  inputs;
+  };
+
+  /* How many times an idle worker polls the queue before going to
+   * sleep. Requests that arrive back to back are then picked up
+   * without a round trip through the kernel. */
+  constexpr unsigned int worker_spin_count = 64;
+
+  struct WorkerPoolState
+  {
+    torch::gobject::MPMCQueue <WorkerPoolJob *> queue;
+    std::vector <std::thread>                   threads;
+
+    /* Only used to put idle workers to sleep and wake them up again,
+     * the queue itself does not take the lock */
+    std::mutex              mutex;
+    std::condition_variable wake;
+    std::atomic <gint>      n_pending;
+    std::atomic <gint>      n_sleeping;
+    std::atomic <bool>      stopping;
+    bool                    inference_mode;
+
+    WorkerPoolState (size_t capacity,
+                     bool   inference_mode) :
+      queue (capacity),
+      n_pending (0),
+      n_sleeping (0),
+      stopping (false),
+      inference_mode (inference_mode)
+    {
+    }
+
+    bool push (WorkerPoolJob *job)
+    {
+      if (!queue.try_push (job))
+        return false;
+
+      /* Either a worker that is about to sleep sees n_pending, or we
+       * see its n_sleeping and wake it up */
+      n_pending.fetch_add (1);
+
+      if (n_sleeping.load () > 0)
+        {
+          std::lock_guard <std::mutex> lock (mutex);
+          wake.notify_one ();
+        }
+
+      return true;
+    }
+
+    bool wait_for_job (WorkerPoolJob *&job)
+    {
+      for (;;)
+        {
+          for (unsigned int i = 0; i < worker_spin_count; ++i)
+            {
+              if (stopping.load ())
+                return false;
+
+              if (queue.try_pop (job))
+                {
+                  n_pending.fetch_sub (1);
+                  return true;
+                }
+
+              std::this_thread::yield ();
+            }
+
+          std::unique_lock <std::mutex> lock (mutex);
+
+          n_sleeping.fetch_add (1);
+          wake.wait (lock, [this]() {
+            return n_pending.load () > 0 || stopping.load ();
+          });
+          n_sleeping.fetch_sub (1);
+        }
+    }
+
+    void stop ()
+    {
+      {
+        std::lock_guard <std::mutex> lock (mutex);
+        stopping.store (true);
+        wake.notify_all ();
+      }
+
+      for (std::thread &thread : threads)
+        {
+          /* Each worker drops its reference on the task of the job it
+           * ran, which can be the last reference on the pool. That
+           * worker cannot join itself, but it holds its own reference
+           * on the state, so it is safe to let it finish detached. */
+          if (thread.get_id () == std::this_thread::get_id ())
+            thread.detach ();
+          else if (thread.joinable ())
+            thread.join ();
+        }
+
+      threads.clear ();
+
+      WorkerPoolJob *job;
+
+      while (queue.try_pop (job))
+        {
+          g_task_return_new_error (job->task,
+                                   G_IO_ERROR,
+                                   G_IO_ERROR_CANCELLED,
+                                   "The worker pool was shut down");
+          g_object_unref (job->task);
+          delete job;
+        }
+    }
+  };
+
+  void
+  run_worker_pool_job (WorkerPoolJob        *job,
+                       torch::nn::AnyModule &replica,
+                       bool                  inference_mode)
+  {
+    if (!g_task_return_error_if_cancelled (job->task))
+      {
+        try
+          {
+            c10::InferenceMode inference_mode_guard (inference_mode);
+            torch::Tensor output = torch_nn_any_module_real_forward (replica, job->inputs);
+
+            g_task_return_pointer (job->task,
+                                   torch_tensor_new_from_real_tensor (output),
+                                   g_object_unref);
+          }
+        catch (std::invalid_argument const &e)
+          {
+            g_task_return_new_error (job->task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT, "%s", e.what ());
+          }
+        catch (std::exception const &e)
+          {
+            g_task_return_new_error (job->task, G_IO_ERROR, G_IO_ERROR_FAILED, "%s", e.what ());
+          }
+      }
+
+    g_object_unref (job->task);
+    delete job;
+  }
+
+  void
+  run_worker (std::shared_ptr <WorkerPoolState> state,
+              torch::nn::AnyModule              replica)
+  {
+    WorkerPoolJob *job;
+
+    while (state->wait_for_job (job))
+      {
+        torch_runtime_apply_cpu_affinity_to_current_thread ();
+        run_worker_pool_job (job, replica, state->inference_mode);
+      }
+  }
+
+  /* Each replica gets its own module objects, so that forward passes
+   * on different threads do not touch the same autograd metadata, but
+   * the parameter tensors are pointed back at the storage of the
+   * source module, so the weights are only in memory once. */
+  torch::nn::AnyModule
+  make_replica (torch::nn::AnyModule &source)
+  {
+    torch::nn::AnyModule replica = source.clone ();
+    torch::NoGradGuard   no_grad;
+    auto                 source_parameters = source.ptr ()->named_parameters ();
+
+    for (auto &parameter : replica.ptr ()->named_parameters ())
+      parameter.value ().set_data (source_parameters[parameter.key ()]);
+
+    return replica;
+  }
+}
+
+typedef struct _TorchNNWorkerPoolPrivate
+{
+  TorchNNAnyModule *module;
+  guint             n_replicas;
+  guint             queue_capacity;
+
+  /* Shared with the worker threads, see WorkerPoolState::stop */
+  std::shared_ptr <WorkerPoolState> state;
+} TorchNNWorkerPoolPrivate;
+
+static void initable_iface_init (GInitableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TorchNNWorkerPool, torch_nn_worker_pool, G_TYPE_OBJECT,
+                         G_ADD_PRIVATE (TorchNNWorkerPool)
+                         G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, initable_iface_init))
+#define TORCH_NN_WORKER_POOL_GET_PRIVATE(a) static_cast <TorchNNWorkerPoolPrivate *> (torch_nn_worker_pool_get_instance_private ((a)))
+
+enum {
+  PROP_0,
+  PROP_MODULE,
+  PROP_N_REPLICAS,
+  PROP_QUEUE_CAPACITY,
+  NPROPS
+};
+
+static GParamSpec *torch_nn_worker_pool_props [NPROPS] = { NULL, };
+
+/**
+ * torch_nn_worker_pool_get_n_replicas:
+ * @pool: A #TorchNNWorkerPool
+ *
+ * Get the number of replicas of the module, which is also the number
+ * of forward passes that can run at the same time.
+ *
+ * Returns: The number of replicas.
+ */
+guint
+torch_nn_worker_pool_get_n_replicas (TorchNNWorkerPool *pool)
+{
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+
+  g_return_val_if_fail (TORCH_IS_NN_WORKER_POOL (pool), 0);
+
+  return priv->n_replicas;
+}
+
+/**
+ * torch_nn_worker_pool_forward_async:
+ * @pool: A #TorchNNWorkerPool
+ * @inputs: (element-type TorchTensor): A #GPtrArray of #TorchTensor to
+ *          pass to forward as positional arguments, see
+ *          %torch_nn_any_module_forward.
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call with the result.
+ * @user_data: The data to pass to @callback.
+ *
+ * Queue a forward pass of the module with @inputs. It runs on the
+ * first replica that becomes idle. Cancelling @cancellable only has
+ * an effect if the forward pass has not started running yet.
+ *
+ * If there are already #TorchNNWorkerPool:queue-capacity requests
+ * waiting, the request fails with %G_IO_ERROR_BUSY.
+ */
+void
+torch_nn_worker_pool_forward_async (TorchNNWorkerPool   *pool,
+                                    GPtrArray           *inputs,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data)
+{
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+  g_autoptr (GTask)         task = NULL;
+  g_autoptr (GError)        error = NULL;
+
+  g_return_if_fail (TORCH_IS_NN_WORKER_POOL (pool));
+  g_return_if_fail (inputs != NULL);
+
+  task = g_task_new (pool, cancellable, callback, user_data);
+  g_task_set_source_tag (task, reinterpret_cast <gpointer> (torch_nn_worker_pool_forward_async));
+
+  /* The tensors are converted here, since TorchTensor may only be
+   * used from one thread at a time */
+  WorkerPoolJob *job = call_set_error_on_exception (&error, G_IO_ERROR, G_IO_ERROR_FAILED, static_cast <WorkerPoolJob *> (nullptr), [&]() -> WorkerPoolJob * {
+    std::unique_ptr <WorkerPoolJob> job (new WorkerPoolJob ());
+
+    job->inputs.reserve (inputs->len);
+
+    for (guint i = 0; i < inputs->len; ++i)
+      {
+        TorchTensor *input = static_cast <TorchTensor *> (g_ptr_array_index (inputs, i));
+
+        job->inputs.push_back (input != NULL ? torch_tensor_get_real_tensor (input) : torch::Tensor ());
+      }
+
+    return job.release ();
+  });
+
+  if (job == NULL)
+    {
+      g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&error)));
+      return;
+    }
+
+  job->task = static_cast <GTask *> (g_object_ref (task));
+
+  if (!priv->state->push (job))
+    {
+      g_object_unref (job->task);
+      delete job;
+
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_BUSY,
+                               "Too many requests are waiting for a replica");
+    }
+}
+
+/**
+ * torch_nn_worker_pool_forward_finish:
+ * @pool: A #TorchNNWorkerPool
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %torch_nn_worker_pool_forward_async.
+ *
+ * Returns: (transfer full): The #TorchTensor returned by forward, or
+ *          %NULL with @error set on failure.
+ */
+TorchTensor *
+torch_nn_worker_pool_forward_finish (TorchNNWorkerPool  *pool,
+                                     GAsyncResult       *result,
+                                     GError            **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, pool), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        reinterpret_cast <gpointer> (torch_nn_worker_pool_forward_async), NULL);
+
+  return static_cast <TorchTensor *> (g_task_propagate_pointer (G_TASK (result), error));
+}
+
+static gboolean
+torch_nn_worker_pool_initable_init (GInitable     *initable,
+                                    GCancellable  *cancellable,
+                                    GError       **error)
+{
+  TorchNNWorkerPool        *pool = TORCH_NN_WORKER_POOL (initable);
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+
+  if (priv->state != nullptr)
+    return TRUE;
+
+  if (priv->module == NULL)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   "A TorchNNWorkerPool needs a module to replicate");
+      return FALSE;
+    }
+
+  if (priv->n_replicas == 0)
+    priv->n_replicas = g_get_num_processors ();
+
+  return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, FALSE, [&]() -> gboolean {
+    torch::nn::AnyModule &source = torch_nn_any_module_to_real_any_module (priv->module);
+    std::vector <torch::nn::AnyModule> replicas;
+
+    /* Clone everything up front, so that a module which cannot be
+     * cloned fails construction without leaving threads behind */
+    replicas.reserve (priv->n_replicas);
+
+    for (guint i = 0; i < priv->n_replicas; ++i)
+      replicas.push_back (make_replica (source));
+
+    bool inference_mode = torch_nn_any_module_get_inference_mode (priv->module);
+    auto state = std::make_shared <WorkerPoolState> (priv->queue_capacity, inference_mode);
+
+    for (torch::nn::AnyModule &replica : replicas)
+      state->threads.emplace_back (run_worker, state, std::move (replica));
+
+    priv->state = std::move (state);
+    return TRUE;
+  });
+}
+
+static void
+initable_iface_init (GInitableIface *iface)
+{
+  iface->init = torch_nn_worker_pool_initable_init;
+}
+
+static void
+torch_nn_worker_pool_init (TorchNNWorkerPool *pool)
+{
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+
+  new (&priv->state) std::shared_ptr <WorkerPoolState> ();
+}
+
+static void
+torch_nn_worker_pool_get_property (GObject      *object,
+                                   unsigned int  prop_id,
+                                   GValue       *value,
+                                   GParamSpec   *pspec)
+{
+  TorchNNWorkerPool *pool = TORCH_NN_WORKER_POOL (object);
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+
+  switch (prop_id)
+    {
+      case PROP_MODULE:
+        g_value_set_object (value, priv->module);
+        break;
+      case PROP_N_REPLICAS:
+        g_value_set_uint (value, priv->n_replicas);
+        break;
+      case PROP_QUEUE_CAPACITY:
+        g_value_set_uint (value, priv->queue_capacity);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_nn_worker_pool_set_property (GObject      *object,
+                                   unsigned int  prop_id,
+                                   const GValue *value,
+                                   GParamSpec   *pspec)
+{
+  TorchNNWorkerPool *pool = TORCH_NN_WORKER_POOL (object);
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+
+  /* Properties only get set on construction */
+  switch (prop_id)
+    {
+      case PROP_MODULE:
+        priv->module = static_cast <TorchNNAnyModule *> (g_value_dup_object (value));
+        break;
+      case PROP_N_REPLICAS:
+        priv->n_replicas = g_value_get_uint (value);
+        break;
+      case PROP_QUEUE_CAPACITY:
+        priv->queue_capacity = g_value_get_uint (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_nn_worker_pool_dispose (GObject *object)
+{
+  TorchNNWorkerPool *pool = TORCH_NN_WORKER_POOL (object);
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+
+  if (priv->state != nullptr)
+    priv->state->stop ();
+
+  g_clear_object (&priv->module);
+
+  G_OBJECT_CLASS (torch_nn_worker_pool_parent_class)->dispose (object);
+}
+
+static void
+torch_nn_worker_pool_finalize (GObject *object)
+{
+  TorchNNWorkerPool *pool = TORCH_NN_WORKER_POOL (object);
+  TorchNNWorkerPoolPrivate *priv = TORCH_NN_WORKER_POOL_GET_PRIVATE (pool);
+
+  priv->state.~shared_ptr ();
+
+  G_OBJECT_CLASS (torch_nn_worker_pool_parent_class)->finalize (object);
+}
+
+static void
+torch_nn_worker_pool_class_init (TorchNNWorkerPoolClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = torch_nn_worker_pool_get_property;
+  object_class->set_property = torch_nn_worker_pool_set_property;
+  object_class->dispose = torch_nn_worker_pool_dispose;
+  object_class->finalize = torch_nn_worker_pool_finalize;
+
+  torch_nn_worker_pool_props[PROP_MODULE] =
+    g_param_spec_object ("module",
+                         "Module",
+                         "TorchNNAnyModule to run forward passes of",
+                         TORCH_TYPE_NN_ANY_MODULE,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_nn_worker_pool_props[PROP_N_REPLICAS] =
+    g_param_spec_uint ("n-replicas",
+                       "Number of Replicas",
+                       "Number of copies of the module, each with its own thread, or 0 for one per CPU",
+                       0,
+                       G_MAXUINT,
+                       0,
+                       static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_nn_worker_pool_props[PROP_QUEUE_CAPACITY] =
+    g_param_spec_uint ("queue-capacity",
+                       "Queue Capacity",
+                       "Maximum number of requests waiting for a replica, rounded up to a power of two",
+                       2,
+                       G_MAXINT,
+                       1024,
+                       static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_properties (object_class,
+                                     NPROPS,
+                                     torch_nn_worker_pool_props);
+}
+
+/**
+ * torch_nn_worker_pool_new:
+ * @module: A #TorchNNAnyModule to run forward passes of.
+ * @n_replicas: The number of replicas, or 0 for one per CPU.
+ * @error: A #GError
+ *
+ * Create a new #TorchNNWorkerPool, which clones @module @n_replicas
+ * times and runs each clone on its own thread. The clones share the
+ * parameters of @module, which must not be modified while the pool is
+ * in use. Requests are handed to whichever replica is idle, so that
+ * independent forward passes run in parallel instead of contending on
+ * a single module.
+ *
+ * Returns: (transfer full): A new #TorchNNWorkerPool or %NULL with
+ *          @error set on failure.
+ */
+TorchNNWorkerPool *
+torch_nn_worker_pool_new (TorchNNAnyModule  *module,
+                          guint              n_replicas,
+                          GError           **error)
+{
+  return static_cast <TorchNNWorkerPool *> (g_initable_new (TORCH_TYPE_NN_WORKER_POOL,
+                                                            NULL,
+                                                            error,
+                                                            "module", module,
+                                                            "n-replicas", n_replicas,
+                                                            NULL));
+}
@@ -0,0 +1,52 @@
+/*
+ * torch-gobject/nn/torch-nn-worker-pool.h
+ *
+ * Run forward passes of a module concurrently on per-thread replicas.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <glib-object.h>
+
+#include <torch-gobject/nn/torch-nn-any-module.h>
+#include <torch-gobject/torch-tensor.h>
+
+G_BEGIN_DECLS
+
+#define TORCH_TYPE_NN_WORKER_POOL torch_nn_worker_pool_get_type ()
+G_DECLARE_FINAL_TYPE (TorchNNWorkerPool, torch_nn_worker_pool, TORCH, NN_WORKER_POOL, GObject)
+
+TorchNNWorkerPool * torch_nn_worker_pool_new (TorchNNAnyModule  *module,
+                                              guint              n_replicas,
+                                              GError           **error);
+
+guint torch_nn_worker_pool_get_n_replicas (TorchNNWorkerPool *pool);
+
+void torch_nn_worker_pool_forward_async (TorchNNWorkerPool   *pool,
+                                         GPtrArray           *inputs,
+                                         GCancellable        *cancellable,
+                                         GAsyncReadyCallback  callback,
+                                         gpointer             user_data);
+
+TorchTensor * torch_nn_worker_pool_forward_finish (TorchNNWorkerPool  *pool,
+                                                   GAsyncResult       *result,
+                                                   GError            **error);
+
+G_END_DECLS
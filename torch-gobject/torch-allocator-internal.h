@@ -29,6 +29,11 @@
 
 c10::Allocator & torch_allocator_get_real_allocator (TorchAllocator *allocator);
 
+/* Takes ownership of @real_allocator, which is deleted when @allocator
+ * is finalized. Only to be called by subclasses during construction. */
+void torch_allocator_set_real_allocator (TorchAllocator *allocator,
+                                         c10::Allocator *real_allocator);
+
 TorchAllocator * torch_allocator_new_from_real_allocator (c10::Allocator const &allocator);
 
 namespace torch
@@ -20,24 +20,51 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #include <torch-gobject/torch-allocator.h>
 #include <torch-gobject/torch-allocator-internal.h>
 
 #include <c10/core/Allocator.h>
 
-struct _TorchAllocator
-{
-  GObject parent_instance;
-};
+namespace {
+class CachingPool;
+}
 
 typedef struct _TorchAllocatorPrivate
 {
   c10::Allocator *internal;
+  CachingPool    *pool;
+
+  gboolean        caching;
+  guint64         max_retained_bytes;
+  guint           alignment;
+  guint64         huge_page_threshold;
 } TorchAllocatorPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (TorchAllocator, torch_allocator, G_TYPE_OBJECT)
 #define TORCH_ALLOCATOR_GET_PRIVATE(x) static_cast <TorchAllocatorPrivate *> (torch_allocator_get_instance_private ((x)))
 
+enum {
+  PROP_0,
+  PROP_CACHING,
+  PROP_MAX_RETAINED_BYTES,
+  PROP_ALIGNMENT,
+  PROP_HUGE_PAGE_THRESHOLD,
+  NPROPS
+};
+
+static GParamSpec *torch_allocator_props [NPROPS] = { NULL, };
+
 c10::Allocator &
 torch_allocator_get_real_allocator (TorchAllocator *allocator)
 {
@@ -46,6 +73,16 @@ torch_allocator_get_real_allocator (TorchAllocator *allocator)
   return *priv->internal;
 }
 
+void
+torch_allocator_set_real_allocator (TorchAllocator *allocator,
+                                    c10::Allocator *real_allocator)
+{
+  TorchAllocatorPrivate *priv = TORCH_ALLOCATOR_GET_PRIVATE (allocator);
+
+  g_assert (priv->internal == nullptr);
+  priv->internal = real_allocator;
+}
+
 namespace {
 struct GLibAllocator:
   public c10::Allocator
@@ -56,13 +93,404 @@ struct GLibAllocator:
     return c10::DataPtr (mem, mem, reinterpret_cast <c10::DeleterFnPtr> (g_free), c10::DeviceType::CPU);
   }
 };
+
+/* Allocates memory with posix_memalign, so that vectorized kernels can
+ * use their aligned loads, and backs allocations of at least
+ * huge_page_threshold bytes with transparent huge pages where the
+ * platform supports it, so that large weight tensors need fewer
+ * TLB entries. */
+struct AlignedAllocator:
+  public c10::Allocator
+{
+  AlignedAllocator (size_t alignment, size_t huge_page_threshold) :
+    alignment (alignment),
+    huge_page_threshold (huge_page_threshold)
+  {
+  }
+
+  c10::DataPtr allocate(size_t n) const
+  {
+    if (n == 0)
+      return c10::DataPtr (nullptr, c10::Device (c10::DeviceType::CPU));
+
+#ifdef __linux__
+    if (huge_page_threshold != 0 && n >= huge_page_threshold)
+      {
+        MappedRegion *region = MappedRegion::map_huge_pages (n);
+
+        if (region != nullptr)
+          return c10::DataPtr (region->data, region, &MappedRegion::unmap, c10::DeviceType::CPU);
+      }
+#endif
+
+    void *mem = nullptr;
+
+    if (posix_memalign (&mem, alignment, n) != 0)
+      throw std::bad_alloc ();
+
+    return c10::DataPtr (mem, mem, free, c10::DeviceType::CPU);
+  }
+
+#ifdef __linux__
+  struct MappedRegion
+  {
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    void   *data;
+    size_t  length;
+
+    /* Transparent huge pages are only used for ranges aligned to the
+     * huge page size, so map an extra huge page and trim the ends to
+     * get an aligned range. Returns nullptr if the mapping fails, in
+     * which case the caller falls back to regular pages. */
+    static MappedRegion * map_huge_pages (size_t n)
+    {
+      const size_t length = (n + kHugePageSize - 1) & ~(kHugePageSize - 1);
+      const size_t mapped_length = length + kHugePageSize;
+      void *mapped = mmap (nullptr,
+                           mapped_length,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS,
+                           -1,
+                           0);
+
+      if (mapped == MAP_FAILED)
+        return nullptr;
+
+      char *mapped_start = static_cast <char *> (mapped);
+      char *mapped_end = mapped_start + mapped_length;
+      char *start = reinterpret_cast <char *> ((reinterpret_cast <uintptr_t> (mapped_start) + kHugePageSize - 1) &
+                                               ~static_cast <uintptr_t> (kHugePageSize - 1));
+      char *end = start + length;
+
+      if (start != mapped_start)
+        munmap (mapped_start, start - mapped_start);
+
+      if (end != mapped_end)
+        munmap (end, mapped_end - end);
+
+      /* Only a hint, the kernel may not have huge pages enabled */
+      madvise (start, length, MADV_HUGEPAGE);
+
+      return new MappedRegion { start, length };
+    }
+
+    static void unmap (void *ctx)
+    {
+      MappedRegion *region = static_cast <MappedRegion *> (ctx);
+
+      munmap (region->data, region->length);
+      delete region;
+    }
+  };
+#endif
+
+  size_t alignment;
+  size_t huge_page_threshold;
+};
+
+/* Blocks are rounded up to a power of two between 2^kMinSizeClassShift
+ * and 2^kMaxSizeClassShift bytes and kept on a free list per size
+ * class when released. Larger requests go straight to g_malloc. */
+constexpr size_t kMinSizeClassShift = 6;
+constexpr size_t kMaxSizeClassShift = 28;
+constexpr size_t kNSizeClasses = kMaxSizeClassShift - kMinSizeClassShift + 1;
+constexpr size_t kUncachedSizeClass = kNSizeClasses;
+
+/* Each block starts with a header recording where it should go back
+ * to when it is released. The header is padded so that the data after
+ * it keeps the alignment of g_malloc. */
+struct alignas (16) BlockHeader
+{
+  CachingPool *pool;
+  size_t       size_class;
+};
+
+/* The pool is reference counted separately from the TorchAllocator:
+ * every outstanding block holds a reference, so tensors can outlive
+ * the allocator that created them. */
+class CachingPool
+{
+  public:
+    explicit CachingPool (size_t max_retained_bytes) :
+      ref_count (1),
+      max_retained_bytes (max_retained_bytes),
+      retained_bytes (0),
+      hits (0),
+      misses (0)
+    {
+    }
+
+    CachingPool (CachingPool const &) = delete;
+    CachingPool & operator= (CachingPool const &) = delete;
+
+    void ref ()
+    {
+      ref_count.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    void unref ()
+    {
+      if (ref_count.fetch_sub (1, std::memory_order_acq_rel) == 1)
+        {
+          trim ();
+          delete this;
+        }
+    }
+
+    BlockHeader * acquire (size_t n_bytes)
+    {
+      const size_t size_class = size_class_for_bytes (n_bytes);
+      BlockHeader *header = nullptr;
+
+      if (size_class != kUncachedSizeClass)
+        {
+          std::lock_guard <std::mutex> lock (mutex);
+          std::vector <BlockHeader *> &free_list = free_lists[size_class];
+
+          if (!free_list.empty ())
+            {
+              header = free_list.back ();
+              free_list.pop_back ();
+              retained_bytes -= bytes_for_size_class (size_class);
+              ++hits;
+            }
+          else
+            {
+              ++misses;
+            }
+        }
+
+      if (header == nullptr)
+        {
+          const size_t block_bytes = size_class != kUncachedSizeClass ?
+                                     bytes_for_size_class (size_class) : n_bytes;
+
+          header = static_cast <BlockHeader *> (g_malloc (sizeof (BlockHeader) + block_bytes));
+          header->pool = this;
+          header->size_class = size_class;
+        }
+
+      ref ();
+      return header;
+    }
+
+    void release (BlockHeader *header)
+    {
+      const size_t size_class = header->size_class;
+      bool         retained = false;
+
+      if (size_class != kUncachedSizeClass)
+        {
+          const size_t                 block_bytes = bytes_for_size_class (size_class);
+          std::lock_guard <std::mutex> lock (mutex);
+
+          if (retained_bytes + block_bytes <= max_retained_bytes)
+            {
+              free_lists[size_class].push_back (header);
+              retained_bytes += block_bytes;
+              retained = true;
+            }
+        }
+
+      if (!retained)
+        g_free (header);
+
+      unref ();
+    }
+
+    void trim ()
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+
+      for (auto &free_list : free_lists)
+        {
+          for (BlockHeader *header : free_list)
+            g_free (header);
+
+          free_list.clear ();
+        }
+
+      retained_bytes = 0;
+    }
+
+    void set_max_retained_bytes (size_t max_bytes)
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+      max_retained_bytes = max_bytes;
+    }
+
+    void statistics (guint64 *out_hits,
+                     guint64 *out_misses,
+                     guint64 *out_retained_bytes)
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+
+      if (out_hits != NULL)
+        *out_hits = hits;
+
+      if (out_misses != NULL)
+        *out_misses = misses;
+
+      if (out_retained_bytes != NULL)
+        *out_retained_bytes = retained_bytes;
+    }
+
+  private:
+    static size_t size_class_for_bytes (size_t n_bytes)
+    {
+      for (size_t size_class = 0; size_class < kNSizeClasses; ++size_class)
+        if (n_bytes <= bytes_for_size_class (size_class))
+          return size_class;
+
+      return kUncachedSizeClass;
+    }
+
+    static size_t bytes_for_size_class (size_t size_class)
+    {
+      return static_cast <size_t> (1) << (size_class + kMinSizeClassShift);
+    }
+
+    std::atomic <int>            ref_count;
+    std::mutex                   mutex;
+    std::vector <BlockHeader *>  free_lists[kNSizeClasses];
+    size_t                       max_retained_bytes;
+    size_t                       retained_bytes;
+    guint64                      hits;
+    guint64                      misses;
+};
+
+struct CachingAllocator:
+  public c10::Allocator
+{
+  /* Takes ownership of the initial reference on @pool */
+  explicit CachingAllocator (CachingPool *pool) :
+    pool (pool)
+  {
+  }
+
+  ~CachingAllocator ()
+  {
+    pool->unref ();
+  }
+
+  c10::DataPtr allocate(size_t n) const
+  {
+    if (n == 0)
+      return c10::DataPtr (nullptr, c10::Device (c10::DeviceType::CPU));
+
+    BlockHeader *header = pool->acquire (n);
+    return c10::DataPtr (header + 1, header, &CachingAllocator::release, c10::DeviceType::CPU);
+  }
+
+  static void release (void *ctx)
+  {
+    BlockHeader *header = static_cast <BlockHeader *> (ctx);
+    header->pool->release (header);
+  }
+
+  CachingPool *pool;
+};
 }
 
 static void
 torch_allocator_init (TorchAllocator *allocator)
 {
+}
+
+static void
+torch_allocator_constructed (GObject *object)
+{
+  TorchAllocator *allocator = TORCH_ALLOCATOR (object);
+  TorchAllocatorPrivate *priv = TORCH_ALLOCATOR_GET_PRIVATE (allocator);
+
+  /* Subclasses provide their own allocator by calling
+   * torch_allocator_set_real_allocator before chaining up */
+  if (priv->internal == nullptr)
+    {
+      if (priv->caching)
+        {
+          priv->pool = new CachingPool (priv->max_retained_bytes);
+          priv->internal = new CachingAllocator (priv->pool);
+        }
+      else if (priv->alignment != 0 || priv->huge_page_threshold != 0)
+        {
+          size_t alignment = MAX (priv->alignment, sizeof (void *));
+
+          if ((alignment & (alignment - 1)) != 0)
+            {
+              g_critical ("TorchAllocator:alignment must be a power of two, got %u", priv->alignment);
+              alignment = sizeof (void *);
+            }
+
+          priv->internal = new AlignedAllocator (alignment, priv->huge_page_threshold);
+        }
+      else
+        {
+          priv->internal = new GLibAllocator();
+        }
+    }
+
+  G_OBJECT_CLASS (torch_allocator_parent_class)->constructed (object);
+}
+
+static void
+torch_allocator_get_property (GObject      *object,
+                              unsigned int  prop_id,
+                              GValue       *value,
+                              GParamSpec   *pspec)
+{
+  TorchAllocator *allocator = TORCH_ALLOCATOR (object);
+  TorchAllocatorPrivate *priv = TORCH_ALLOCATOR_GET_PRIVATE (allocator);
+
+  switch (prop_id)
+    {
+      case PROP_CACHING:
+        g_value_set_boolean (value, priv->caching);
+        break;
+      case PROP_MAX_RETAINED_BYTES:
+        g_value_set_uint64 (value, priv->max_retained_bytes);
+        break;
+      case PROP_ALIGNMENT:
+        g_value_set_uint (value, priv->alignment);
+        break;
+      case PROP_HUGE_PAGE_THRESHOLD:
+        g_value_set_uint64 (value, priv->huge_page_threshold);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_allocator_set_property (GObject      *object,
+                              unsigned int  prop_id,
+                              const GValue *value,
+                              GParamSpec   *pspec)
+{
+  TorchAllocator *allocator = TORCH_ALLOCATOR (object);
   TorchAllocatorPrivate *priv = TORCH_ALLOCATOR_GET_PRIVATE (allocator);
-  priv->internal = new GLibAllocator();
+
+  /* Properties only get set on construction */
+  switch (prop_id)
+    {
+      case PROP_CACHING:
+        priv->caching = g_value_get_boolean (value);
+        break;
+      case PROP_MAX_RETAINED_BYTES:
+        priv->max_retained_bytes = g_value_get_uint64 (value);
+        break;
+      case PROP_ALIGNMENT:
+        priv->alignment = g_value_get_uint (value);
+        break;
+      case PROP_HUGE_PAGE_THRESHOLD:
+        priv->huge_page_threshold = g_value_get_uint64 (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
 }
 
 static void
@@ -71,11 +499,22 @@ torch_allocator_finalize (GObject *object)
   TorchAllocator *allocator = TORCH_ALLOCATOR (object);
   TorchAllocatorPrivate *priv = TORCH_ALLOCATOR_GET_PRIVATE (allocator);
 
+  /* Blocks which are still in use keep the pool alive, but there is
+   * no point in retaining any more of them once they are released. */
+  if (priv->pool)
+    {
+      priv->pool->set_max_retained_bytes (0);
+      priv->pool->trim ();
+      priv->pool = nullptr;
+    }
+
   if (priv->internal)
     {
       delete priv->internal;
       priv->internal = nullptr;
     }
+
+  G_OBJECT_CLASS (torch_allocator_parent_class)->finalize (object);
 }
 
 static void
@@ -83,7 +522,103 @@ torch_allocator_class_init (TorchAllocatorClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->constructed = torch_allocator_constructed;
+  object_class->get_property = torch_allocator_get_property;
+  object_class->set_property = torch_allocator_set_property;
   object_class->finalize = torch_allocator_finalize;
+
+  torch_allocator_props[PROP_CACHING] =
+    g_param_spec_boolean ("caching",
+                          "Caching",
+                          "Whether released blocks are kept for reuse",
+                          FALSE,
+                          static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_allocator_props[PROP_MAX_RETAINED_BYTES] =
+    g_param_spec_uint64 ("max-retained-bytes",
+                         "Max Retained Bytes",
+                         "Upper bound on the bytes kept for reuse by a caching allocator",
+                         0,
+                         G_MAXUINT64,
+                         0,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_allocator_props[PROP_ALIGNMENT] =
+    g_param_spec_uint ("alignment",
+                       "Alignment",
+                       "Alignment in bytes of allocated memory, which must be a power of two, "
+                       "or 0 for the alignment of g_malloc. Not used by caching allocators.",
+                       0,
+                       G_MAXUINT,
+                       0,
+                       static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_allocator_props[PROP_HUGE_PAGE_THRESHOLD] =
+    g_param_spec_uint64 ("huge-page-threshold",
+                         "Huge Page Threshold",
+                         "Allocations of at least this many bytes are backed by huge pages "
+                         "where supported, or 0 to never use huge pages. Not used by caching allocators.",
+                         0,
+                         G_MAXUINT64,
+                         0,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_properties (object_class,
+                                     NPROPS,
+                                     torch_allocator_props);
+}
+
+/**
+ * torch_allocator_trim:
+ * @allocator: A #TorchAllocator
+ *
+ * Release all the memory that @allocator is holding on to for
+ * reuse. Memory which is still in use by a storage is not affected.
+ * This does nothing if @allocator is not a caching allocator.
+ */
+void
+torch_allocator_trim (TorchAllocator *allocator)
+{
+  TorchAllocatorPrivate *priv = TORCH_ALLOCATOR_GET_PRIVATE (allocator);
+
+  if (priv->pool)
+    priv->pool->trim ();
+}
+
+/**
+ * torch_allocator_get_cache_statistics:
+ * @allocator: A #TorchAllocator
+ * @out_hits: (out) (optional): The number of allocations served from the cache
+ * @out_misses: (out) (optional): The number of allocations that needed new memory
+ * @out_retained_bytes: (out) (optional): The number of bytes currently held for reuse
+ *
+ * Get statistics on how well the cache of a caching allocator
+ * is working. All the statistics are zero if @allocator is not a
+ * caching allocator. Allocations too large to be cached are
+ * not counted.
+ */
+void
+torch_allocator_get_cache_statistics (TorchAllocator *allocator,
+                                      guint64        *out_hits,
+                                      guint64        *out_misses,
+                                      guint64        *out_retained_bytes)
+{
+  TorchAllocatorPrivate *priv = TORCH_ALLOCATOR_GET_PRIVATE (allocator);
+
+  if (priv->pool)
+    {
+      priv->pool->statistics (out_hits, out_misses, out_retained_bytes);
+      return;
+    }
+
+  if (out_hits != NULL)
+    *out_hits = 0;
+
+  if (out_misses != NULL)
+    *out_misses = 0;
+
+  if (out_retained_bytes != NULL)
+    *out_retained_bytes = 0;
 }
 
 TorchAllocator *
@@ -91,3 +626,56 @@ torch_allocator_new (void)
 {
   return static_cast<TorchAllocator *> (g_object_new (TORCH_TYPE_ALLOCATOR, NULL));
 }
+
+/**
+ * torch_allocator_new_caching:
+ * @max_retained_bytes: The maximum number of released bytes to keep for reuse
+ *
+ * Create a new #TorchAllocator which keeps released memory on
+ * free lists, one per power-of-two size class, and hands it out
+ * again for later allocations of a similar size. This avoids going
+ * through the system allocator when tensors of the same shapes are
+ * created and destroyed repeatedly.
+ *
+ * At most @max_retained_bytes are kept for reuse; memory released
+ * beyond that is returned to the system straight away. Use
+ * %torch_allocator_trim to release the retained memory early.
+ *
+ * Returns: (transfer full): A new caching #TorchAllocator
+ */
+TorchAllocator *
+torch_allocator_new_caching (gsize max_retained_bytes)
+{
+  return static_cast<TorchAllocator *> (g_object_new (TORCH_TYPE_ALLOCATOR,
+                                                      "caching", TRUE,
+                                                      "max-retained-bytes", static_cast <guint64> (max_retained_bytes),
+                                                      NULL));
+}
+
+/**
+ * torch_allocator_new_aligned:
+ * @alignment: The alignment of allocated memory in bytes, a power of two
+ * @huge_page_threshold: The size in bytes from which allocations are
+ *                       backed by huge pages, or 0 to never use them
+ *
+ * Create a new #TorchAllocator which aligns memory to @alignment
+ * bytes. An alignment of 64 bytes (a cache line) keeps the
+ * vectorized CPU kernels on their aligned fast paths.
+ *
+ * Allocations of at least @huge_page_threshold bytes are mapped
+ * separately and marked with MADV_HUGEPAGE on platforms which
+ * support transparent huge pages, which reduces TLB misses when
+ * working with very large tensors. On other platforms, or if the
+ * mapping fails, they are allocated like any other allocation.
+ *
+ * Returns: (transfer full): A new #TorchAllocator
+ */
+TorchAllocator *
+torch_allocator_new_aligned (guint   alignment,
+                             guint64 huge_page_threshold)
+{
+  return static_cast<TorchAllocator *> (g_object_new (TORCH_TYPE_ALLOCATOR,
+                                                      "alignment", alignment,
+                                                      "huge-page-threshold", huge_page_threshold,
+                                                      NULL));
+}
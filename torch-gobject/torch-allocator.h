@@ -27,8 +27,27 @@
 G_BEGIN_DECLS
 
 #define TORCH_TYPE_ALLOCATOR torch_allocator_get_type ()
-G_DECLARE_FINAL_TYPE (TorchAllocator, torch_allocator, TORCH, ALLOCATOR, GObject)
+G_DECLARE_DERIVABLE_TYPE (TorchAllocator, torch_allocator, TORCH, ALLOCATOR, GObject)
+
+struct _TorchAllocatorClass
+{
+  GObjectClass object_class;
+
+  gpointer padding[16];
+};
 
 TorchAllocator * torch_allocator_new (void);
 
+TorchAllocator * torch_allocator_new_caching (gsize max_retained_bytes);
+
+TorchAllocator * torch_allocator_new_aligned (guint   alignment,
+                                              guint64 huge_page_threshold);
+
+void torch_allocator_trim (TorchAllocator *allocator);
+
+void torch_allocator_get_cache_statistics (TorchAllocator *allocator,
+                                           guint64        *out_hits,
+                                           guint64        *out_misses,
+                                           guint64        *out_retained_bytes);
+
 G_END_DECLS
@@ -0,0 +1,351 @@
+/*
+ * torch-gobject/torch-arena-allocator.cpp
+ *
+ * Allocator which carves storage out of large slabs and releases
+ * everything at once.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <torch-gobject/torch-allocator.h>
+#include <torch-gobject/torch-allocator-internal.h>
+#include <torch-gobject/torch-arena-allocator.h>
+
+#include <c10/core/Allocator.h>
+
+struct _TorchArenaAllocator
+{
+  TorchAllocator parent_instance;
+};
+
+namespace {
+class ArenaAllocator;
+}
+
+typedef struct _TorchArenaAllocatorPrivate
+{
+  ArenaAllocator *arena;
+
+  guint64         slab_size;
+} TorchArenaAllocatorPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (TorchArenaAllocator, torch_arena_allocator, TORCH_TYPE_ALLOCATOR)
+#define TORCH_ARENA_ALLOCATOR_GET_PRIVATE(x) static_cast <TorchArenaAllocatorPrivate *> (torch_arena_allocator_get_instance_private ((x)))
+
+enum {
+  PROP_0,
+  PROP_SLAB_SIZE,
+  NPROPS
+};
+
+static GParamSpec *torch_arena_allocator_props [NPROPS] = { NULL, };
+
+namespace {
+/* Same alignment as the default CPU allocator in c10 */
+constexpr size_t kArenaAlignment = 64;
+
+size_t
+align_up (size_t n)
+{
+  return (n + kArenaAlignment - 1) & ~(kArenaAlignment - 1);
+}
+
+/* All the slabs handed out between two resets. Every block carved
+ * out of a generation holds a reference on it, so the slabs are only
+ * freed once the arena has moved on and the last block is released. */
+class ArenaGeneration
+{
+  public:
+    ArenaGeneration () :
+      ref_count (1),
+      retired (false),
+      cursor (nullptr),
+      end (nullptr)
+    {
+    }
+
+    ~ArenaGeneration ()
+    {
+      for (char *slab : slabs)
+        g_free (slab);
+    }
+
+    ArenaGeneration (ArenaGeneration const &) = delete;
+    ArenaGeneration & operator= (ArenaGeneration const &) = delete;
+
+    void ref ()
+    {
+      ref_count.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    void unref ()
+    {
+      if (ref_count.fetch_sub (1, std::memory_order_acq_rel) == 1)
+        delete this;
+    }
+
+    /* Must be called with the arena lock held */
+    char * carve (size_t n_bytes, size_t slab_size)
+    {
+      const size_t n_aligned_bytes = align_up (n_bytes);
+
+      if (cursor == nullptr || static_cast <size_t> (end - cursor) < n_aligned_bytes)
+        {
+          const size_t slab_bytes = std::max (slab_size, n_aligned_bytes);
+          char *slab = static_cast <char *> (g_malloc (slab_bytes + kArenaAlignment));
+
+          slabs.push_back (slab);
+          cursor = reinterpret_cast <char *> (align_up (reinterpret_cast <uintptr_t> (slab)));
+          end = cursor + slab_bytes;
+        }
+
+      char *block = cursor;
+      cursor += n_aligned_bytes;
+      bytes_in_use += n_aligned_bytes;
+
+      return block;
+    }
+
+    std::atomic <int>   ref_count;
+    std::atomic <bool>  retired;
+    std::vector <char *> slabs;
+    char                *cursor;
+    char                *end;
+    size_t               bytes_in_use = 0;
+};
+
+class ArenaAllocator:
+  public c10::Allocator
+{
+  public:
+    explicit ArenaAllocator (size_t slab_size) :
+      slab_size (slab_size),
+      generation (new ArenaGeneration ())
+    {
+    }
+
+    ~ArenaAllocator ()
+    {
+      retire_generation ();
+    }
+
+    c10::DataPtr allocate(size_t n) const
+    {
+      if (n == 0)
+        return c10::DataPtr (nullptr, c10::Device (c10::DeviceType::CPU));
+
+      std::lock_guard <std::mutex> lock (mutex);
+      char *block = generation->carve (n, slab_size);
+
+      generation->ref ();
+      return c10::DataPtr (block, generation, &ArenaAllocator::release, c10::DeviceType::CPU);
+    }
+
+    void reset ()
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+
+      retire_generation ();
+      generation = new ArenaGeneration ();
+    }
+
+    size_t bytes_in_use () const
+    {
+      std::lock_guard <std::mutex> lock (mutex);
+      return generation->bytes_in_use;
+    }
+
+  private:
+    void retire_generation ()
+    {
+      generation->retired.store (true, std::memory_order_release);
+      generation->unref ();
+      generation = nullptr;
+    }
+
+    static void release (void *ctx)
+    {
+      ArenaGeneration *released_generation = static_cast <ArenaGeneration *> (ctx);
+
+      /* Individual blocks are never given back to the arena, the
+       * memory is reclaimed all at once on reset. A block that is
+       * released after a reset outlived the session that it was
+       * allocated for. */
+      if (released_generation->retired.load (std::memory_order_acquire))
+        g_critical ("Storage allocated by a TorchArenaAllocator was released "
+                    "after the allocator was reset or destroyed. Storage "
+                    "allocated from an arena must not outlive the current "
+                    "arena session.");
+
+      released_generation->unref ();
+    }
+
+    size_t                   slab_size;
+    mutable std::mutex       mutex;
+    ArenaGeneration         *generation;
+};
+}
+
+static void
+torch_arena_allocator_init (TorchArenaAllocator *allocator)
+{
+}
+
+static void
+torch_arena_allocator_constructed (GObject *object)
+{
+  TorchArenaAllocator *allocator = TORCH_ARENA_ALLOCATOR (object);
+  TorchArenaAllocatorPrivate *priv = TORCH_ARENA_ALLOCATOR_GET_PRIVATE (allocator);
+
+  /* The parent class owns the arena, we only keep a pointer to it
+   * so that it can be reset */
+  priv->arena = new ArenaAllocator (priv->slab_size);
+  torch_allocator_set_real_allocator (TORCH_ALLOCATOR (allocator), priv->arena);
+
+  G_OBJECT_CLASS (torch_arena_allocator_parent_class)->constructed (object);
+}
+
+static void
+torch_arena_allocator_get_property (GObject      *object,
+                                    unsigned int  prop_id,
+                                    GValue       *value,
+                                    GParamSpec   *pspec)
+{
+  TorchArenaAllocator *allocator = TORCH_ARENA_ALLOCATOR (object);
+  TorchArenaAllocatorPrivate *priv = TORCH_ARENA_ALLOCATOR_GET_PRIVATE (allocator);
+
+  switch (prop_id)
+    {
+      case PROP_SLAB_SIZE:
+        g_value_set_uint64 (value, priv->slab_size);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_arena_allocator_set_property (GObject      *object,
+                                    unsigned int  prop_id,
+                                    const GValue *value,
+                                    GParamSpec   *pspec)
+{
+  TorchArenaAllocator *allocator = TORCH_ARENA_ALLOCATOR (object);
+  TorchArenaAllocatorPrivate *priv = TORCH_ARENA_ALLOCATOR_GET_PRIVATE (allocator);
+
+  /* Properties only get set on construction */
+  switch (prop_id)
+    {
+      case PROP_SLAB_SIZE:
+        priv->slab_size = g_value_get_uint64 (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_arena_allocator_class_init (TorchArenaAllocatorClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = torch_arena_allocator_constructed;
+  object_class->get_property = torch_arena_allocator_get_property;
+  object_class->set_property = torch_arena_allocator_set_property;
+
+  torch_arena_allocator_props[PROP_SLAB_SIZE] =
+    g_param_spec_uint64 ("slab-size",
+                         "Slab Size",
+                         "Size of each slab that storage is carved out of",
+                         1,
+                         G_MAXUINT64,
+                         4 * 1024 * 1024,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_properties (object_class,
+                                     NPROPS,
+                                     torch_arena_allocator_props);
+}
+
+/**
+ * torch_arena_allocator_reset:
+ * @allocator: A #TorchArenaAllocator
+ *
+ * Release all the memory handed out by @allocator since it was
+ * created or last reset, and start carving storage out of fresh
+ * slabs.
+ *
+ * All storage allocated from @allocator should be released before
+ * calling this function. Storage which is still alive keeps its
+ * slabs around until it is released, at which point a critical
+ * warning is emitted, since that indicates a lifetime bug.
+ */
+void
+torch_arena_allocator_reset (TorchArenaAllocator *allocator)
+{
+  TorchArenaAllocatorPrivate *priv = TORCH_ARENA_ALLOCATOR_GET_PRIVATE (allocator);
+
+  priv->arena->reset ();
+}
+
+/**
+ * torch_arena_allocator_get_bytes_in_use:
+ * @allocator: A #TorchArenaAllocator
+ *
+ * Get the number of bytes handed out by @allocator since it was
+ * created or last reset, including padding for alignment.
+ *
+ * Returns: The number of bytes in use.
+ */
+gsize
+torch_arena_allocator_get_bytes_in_use (TorchArenaAllocator *allocator)
+{
+  TorchArenaAllocatorPrivate *priv = TORCH_ARENA_ALLOCATOR_GET_PRIVATE (allocator);
+
+  return priv->arena->bytes_in_use ();
+}
+
+/**
+ * torch_arena_allocator_new:
+ * @slab_size: The size of each slab to carve storage out of
+ *
+ * Create a new #TorchArenaAllocator. Allocations are served by
+ * bumping a pointer through slabs of @slab_size bytes (or larger,
+ * for allocations which do not fit in a slab), and releasing
+ * individual storages costs nothing. All the memory is reclaimed
+ * at once by %torch_arena_allocator_reset.
+ *
+ * This suits intermediate tensors that only live for the duration
+ * of a single inference request.
+ *
+ * Returns: (transfer full): A new #TorchArenaAllocator
+ */
+TorchArenaAllocator *
+torch_arena_allocator_new (gsize slab_size)
+{
+  return static_cast <TorchArenaAllocator *> (g_object_new (TORCH_TYPE_ARENA_ALLOCATOR,
+                                                            "slab-size", static_cast <guint64> (slab_size),
+                                                            NULL));
+}
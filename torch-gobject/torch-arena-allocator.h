@@ -0,0 +1,40 @@
+/*
+ * torch-gobject/torch-arena-allocator.h
+ *
+ * Allocator which carves storage out of large slabs and releases
+ * everything at once.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <torch-gobject/torch-allocator.h>
+
+G_BEGIN_DECLS
+
+#define TORCH_TYPE_ARENA_ALLOCATOR torch_arena_allocator_get_type ()
+G_DECLARE_FINAL_TYPE (TorchArenaAllocator, torch_arena_allocator, TORCH, ARENA_ALLOCATOR, TorchAllocator)
+
+TorchArenaAllocator * torch_arena_allocator_new (gsize slab_size);
+
+void torch_arena_allocator_reset (TorchArenaAllocator *allocator);
+
+gsize torch_arena_allocator_get_bytes_in_use (TorchArenaAllocator *allocator);
+
+G_END_DECLS
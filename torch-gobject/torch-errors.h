@@ -30,12 +30,14 @@ G_BEGIN_DECLS
  * TorchError
  * @TORCH_ERROR_INTERNAL: Internal error occurred in torch or PyTorch.
  * @TORCH_ERROR_INVALID_DATA_TYPE: The data type chosen is not supported.
+ * @TORCH_ERROR_INVALID_SHAPE: The shape or strides given do not fit the data.
  *
  * Error enumeration for Scorch related errors.
  */
 typedef enum {
   TORCH_ERROR_INTERNAL,
-  TORCH_ERROR_INVALID_DATA_TYPE
+  TORCH_ERROR_INVALID_DATA_TYPE,
+  TORCH_ERROR_INVALID_SHAPE
 } TorchError;
 
 #define TORCH_ERROR torch_error_quark ()
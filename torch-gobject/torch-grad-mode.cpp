@@ -0,0 +1,187 @@
+/*
+ * torch-gobject/torch-grad-mode.cpp
+ *
+ * Thread-local scopes which disable autograd bookkeeping.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <c10/core/GradMode.h>
+#include <c10/core/InferenceMode.h>
+
+#include <gio/gio.h>
+
+#include <torch-gobject/torch-grad-mode.h>
+
+namespace
+{
+  enum class GradModeScopeKind
+  {
+    InferenceMode,
+    NoGrad
+  };
+
+  /* The libtorch guards restore the previous state when they are
+   * destroyed, so they have to be destroyed in the reverse order of
+   * creation. Keeping them on a per-thread stack lets callers that
+   * cannot use RAII, like language bindings, enter and leave them
+   * with plain function calls. */
+  struct GradModeScope
+  {
+    GradModeScopeKind                   kind;
+    std::unique_ptr <c10::InferenceMode> inference_mode;
+    std::unique_ptr <c10::NoGradGuard>   no_grad;
+  };
+
+  thread_local std::vector <GradModeScope> grad_mode_scopes;
+
+  const char *
+  grad_mode_scope_kind_name (GradModeScopeKind kind)
+  {
+    return kind == GradModeScopeKind::InferenceMode ? "inference mode" : "no-grad mode";
+  }
+
+  gboolean
+  leave_grad_mode_scope (GradModeScopeKind   kind,
+                         GError            **error)
+  {
+    if (grad_mode_scopes.empty () || grad_mode_scopes.back ().kind != kind)
+      {
+        g_set_error (error,
+                     G_IO_ERROR,
+                     G_IO_ERROR_FAILED,
+                     "Cannot leave %s on this thread, %s",
+                     grad_mode_scope_kind_name (kind),
+                     grad_mode_scopes.empty () ?
+                       "no scope was entered" :
+                       grad_mode_scope_kind_name (grad_mode_scopes.back ().kind));
+        return FALSE;
+      }
+
+    grad_mode_scopes.pop_back ();
+    return TRUE;
+  }
+}
+
+/**
+ * torch_inference_mode_enter:
+ *
+ * Enter inference mode on the calling thread. Operations do not
+ * record anything for autograd and the tensors they create skip
+ * version counting, which saves memory and time when only the result
+ * of a computation is needed. Tensors created in inference mode can
+ * not be used in computations that require gradients later.
+ *
+ * Calls may be nested with calls to %torch_no_grad_enter, and each
+ * one has to be matched with a call to %torch_inference_mode_leave
+ * on the same thread.
+ */
+void
+torch_inference_mode_enter (void)
+{
+  grad_mode_scopes.push_back (GradModeScope {
+    GradModeScopeKind::InferenceMode,
+    std::unique_ptr <c10::InferenceMode> (new c10::InferenceMode ()),
+    nullptr
+  });
+}
+
+/**
+ * torch_inference_mode_leave:
+ * @error: A #GError
+ *
+ * Leave the inference mode scope entered by the matching call to
+ * %torch_inference_mode_enter, restoring the previous state.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the innermost
+ *          scope on this thread is not an inference mode scope.
+ */
+gboolean
+torch_inference_mode_leave (GError **error)
+{
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  return leave_grad_mode_scope (GradModeScopeKind::InferenceMode, error);
+}
+
+/**
+ * torch_inference_mode_is_enabled:
+ *
+ * Check whether the calling thread is in inference mode.
+ *
+ * Returns: %TRUE if inference mode is enabled on this thread.
+ */
+gboolean
+torch_inference_mode_is_enabled (void)
+{
+  return c10::InferenceMode::is_enabled ();
+}
+
+/**
+ * torch_no_grad_enter:
+ *
+ * Stop recording operations for autograd on the calling thread.
+ * Unlike inference mode, the tensors created in this scope are normal
+ * tensors that can be used with autograd later.
+ *
+ * Each call has to be matched with a call to %torch_no_grad_leave on
+ * the same thread.
+ */
+void
+torch_no_grad_enter (void)
+{
+  grad_mode_scopes.push_back (GradModeScope {
+    GradModeScopeKind::NoGrad,
+    nullptr,
+    std::unique_ptr <c10::NoGradGuard> (new c10::NoGradGuard ())
+  });
+}
+
+/**
+ * torch_no_grad_leave:
+ * @error: A #GError
+ *
+ * Leave the scope entered by the matching call to
+ * %torch_no_grad_enter, restoring the previous state.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the innermost
+ *          scope on this thread is not a no-grad scope.
+ */
+gboolean
+torch_no_grad_leave (GError **error)
+{
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  return leave_grad_mode_scope (GradModeScopeKind::NoGrad, error);
+}
+
+/**
+ * torch_grad_mode_is_enabled:
+ *
+ * Check whether operations on the calling thread are recorded for
+ * autograd. This is %FALSE in both no-grad mode and inference mode.
+ *
+ * Returns: %TRUE if autograd is enabled on this thread.
+ */
+gboolean
+torch_grad_mode_is_enabled (void)
+{
+  return c10::GradMode::is_enabled ();
+}
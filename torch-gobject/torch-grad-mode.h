@@ -0,0 +1,41 @@
+/*
+ * torch-gobject/torch-grad-mode.h
+ *
+ * Thread-local scopes which disable autograd bookkeeping.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void torch_inference_mode_enter (void);
+
+gboolean torch_inference_mode_leave (GError **error);
+
+gboolean torch_inference_mode_is_enabled (void);
+
+void torch_no_grad_enter (void);
+
+gboolean torch_no_grad_leave (GError **error);
+
+gboolean torch_grad_mode_is_enabled (void);
+
+G_END_DECLS
@@ -0,0 +1,148 @@
+/*
+ * torch-gobject/torch-mpmc-queue-internal.h
+ *
+ * Bounded lock-free multi-producer, multi-consumer queue.
+ *
+ * Copyright (C) 2022 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace torch
+{
+  namespace gobject
+  {
+    /* Dmitry Vyukov's bounded MPMC queue. Each cell carries a sequence
+     * number that tells producers and consumers whether it is free to
+     * be written or ready to be read, so the only contended operation
+     * is a compare-and-swap on the head or tail position.
+     *
+     * The capacity is rounded up to a power of two. try_push fails
+     * when the queue is full and try_pop fails when it is empty, it
+     * is up to the caller to decide whether to wait or give up. */
+    template <typename T>
+    class MPMCQueue
+    {
+      public:
+        explicit MPMCQueue (size_t capacity) :
+          mask (round_up_to_power_of_two (capacity) - 1),
+          cells (new Cell[mask + 1]),
+          enqueue_pos (0),
+          dequeue_pos (0)
+        {
+          for (size_t i = 0; i <= mask; ++i)
+            cells[i].sequence.store (i, std::memory_order_relaxed);
+        }
+
+        MPMCQueue (MPMCQueue const &) = delete;
+        MPMCQueue & operator= (MPMCQueue const &) = delete;
+
+        bool try_push (T value)
+        {
+          Cell   *cell;
+          size_t  pos = enqueue_pos.load (std::memory_order_relaxed);
+
+          for (;;)
+            {
+              cell = &cells[pos & mask];
+
+              size_t    sequence = cell->sequence.load (std::memory_order_acquire);
+              ptrdiff_t diff = static_cast <ptrdiff_t> (sequence) - static_cast <ptrdiff_t> (pos);
+
+              if (diff == 0)
+                {
+                  if (enqueue_pos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                    break;
+                }
+              else if (diff < 0)
+                return false;
+              else
+                pos = enqueue_pos.load (std::memory_order_relaxed);
+            }
+
+          cell->data = std::move (value);
+          cell->sequence.store (pos + 1, std::memory_order_release);
+          return true;
+        }
+
+        bool try_pop (T &value)
+        {
+          Cell   *cell;
+          size_t  pos = dequeue_pos.load (std::memory_order_relaxed);
+
+          for (;;)
+            {
+              cell = &cells[pos & mask];
+
+              size_t    sequence = cell->sequence.load (std::memory_order_acquire);
+              ptrdiff_t diff = static_cast <ptrdiff_t> (sequence) - static_cast <ptrdiff_t> (pos + 1);
+
+              if (diff == 0)
+                {
+                  if (dequeue_pos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                    break;
+                }
+              else if (diff < 0)
+                return false;
+              else
+                pos = dequeue_pos.load (std::memory_order_relaxed);
+            }
+
+          value = std::move (cell->data);
+          cell->sequence.store (pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+
+        size_t capacity () const
+        {
+          return mask + 1;
+        }
+
+      private:
+        static constexpr size_t cache_line_size = 64;
+
+        struct Cell
+        {
+          std::atomic <size_t> sequence;
+          T                    data;
+        };
+
+        static size_t round_up_to_power_of_two (size_t value)
+        {
+          size_t result = 2;
+
+          while (result < value)
+            result <<= 1;
+
+          return result;
+        }
+
+        size_t const             mask;
+        std::unique_ptr <Cell[]> cells;
+
+        /* Kept on separate cache lines so that producers and consumers
+         * do not invalidate each other's view of their position */
+        alignas (cache_line_size) std::atomic <size_t> enqueue_pos;
+        alignas (cache_line_size) std::atomic <size_t> dequeue_pos;
+    };
+  }
+}
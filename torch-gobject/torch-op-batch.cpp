@@ -0,0 +1,689 @@
+/*
+ * torch-gobject/torch-op-batch.cpp
+ *
+ * Record a sequence of operator calls and run them in one go.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ATen/Parallel.h>
+#include <ATen/core/dispatch/Dispatcher.h>
+#include <ATen/core/stack.h>
+
+#include <gio/gio.h>
+
+#include <torch-gobject/torch-op-batch.h>
+#include <torch-gobject/torch-runtime-internal.h>
+#include <torch-gobject/torch-tensor.h>
+#include <torch-gobject/torch-tensor-internal.h>
+#include <torch-gobject/torch-util.h>
+
+struct _TorchOpBatch
+{
+  GObject parent_instance;
+};
+
+namespace
+{
+  struct BatchArgument
+  {
+    enum class Kind
+    {
+      Constant,
+      Slot,
+      SlotList
+    };
+
+    Kind                kind;
+    c10::IValue         constant;
+    std::vector <guint> slots;
+  };
+
+  struct BatchOp
+  {
+    c10::OperatorHandle          handle;
+    std::vector <BatchArgument>  arguments;
+    guint                        first_output_slot;
+    guint                        n_outputs;
+  };
+}
+
+typedef struct _TorchOpBatchPrivate
+{
+  std::vector <BatchOp>     *ops;
+  std::vector <c10::IValue> *slots;
+  std::vector <bool>        *slot_is_input;
+} TorchOpBatchPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (TorchOpBatch, torch_op_batch, G_TYPE_OBJECT)
+#define TORCH_OP_BATCH_GET_PRIVATE(a) static_cast <TorchOpBatchPrivate *> (torch_op_batch_get_instance_private ((a)))
+
+namespace
+{
+  guint
+  check_slot (guint slot, size_t n_slots)
+  {
+    if (slot >= n_slots)
+      throw std::invalid_argument ("Slot " + std::to_string (slot) +
+                                   " does not exist yet, there are only " +
+                                   std::to_string (n_slots) + " slots");
+
+    return slot;
+  }
+
+  BatchArgument
+  constant_argument (c10::IValue value)
+  {
+    return BatchArgument { BatchArgument::Kind::Constant, std::move (value), {} };
+  }
+
+  template <typename T>
+  std::vector <T>
+  vector_from_fixed_array_variant (GVariant *value)
+  {
+    gsize    n_elements = 0;
+    const T *elements = static_cast <const T *> (g_variant_get_fixed_array (value, &n_elements, sizeof (T)));
+
+    return std::vector <T> (elements, elements + n_elements);
+  }
+
+  /* Tensors are referred to by their slot number, everything else
+   * is converted to a constant IValue once, when the op is recorded. */
+  BatchArgument
+  batch_argument_from_variant (GVariant *value, size_t n_slots)
+  {
+    const char *type_string = g_variant_get_type_string (value);
+
+    if (g_str_equal (type_string, "u"))
+      return BatchArgument { BatchArgument::Kind::Slot, c10::IValue (), { check_slot (g_variant_get_uint32 (value), n_slots) } };
+
+    if (g_str_equal (type_string, "au"))
+      {
+        std::vector <guint> slots (vector_from_fixed_array_variant <guint32> (value));
+
+        for (guint slot : slots)
+          check_slot (slot, n_slots);
+
+        return BatchArgument { BatchArgument::Kind::SlotList, c10::IValue (), std::move (slots) };
+      }
+
+    if (g_str_equal (type_string, "()"))
+      return constant_argument (c10::IValue ());
+    if (g_str_equal (type_string, "b"))
+      return constant_argument (c10::IValue (static_cast <bool> (g_variant_get_boolean (value))));
+    if (g_str_equal (type_string, "i"))
+      return constant_argument (c10::IValue (static_cast <int64_t> (g_variant_get_int32 (value))));
+    if (g_str_equal (type_string, "x"))
+      return constant_argument (c10::IValue (static_cast <int64_t> (g_variant_get_int64 (value))));
+    if (g_str_equal (type_string, "d"))
+      return constant_argument (c10::IValue (g_variant_get_double (value)));
+    if (g_str_equal (type_string, "s"))
+      return constant_argument (c10::IValue (std::string (g_variant_get_string (value, NULL))));
+    if (g_str_equal (type_string, "ax"))
+      return constant_argument (c10::IValue (vector_from_fixed_array_variant <int64_t> (value)));
+    if (g_str_equal (type_string, "ad"))
+      return constant_argument (c10::IValue (vector_from_fixed_array_variant <double> (value)));
+
+    throw std::invalid_argument (std::string ("Cannot use a value of type '") +
+                                 type_string +
+                                 "' as an argument");
+  }
+
+  c10::IValue
+  resolve_batch_argument (BatchArgument const &argument, std::vector <c10::IValue> const &slots)
+  {
+    switch (argument.kind)
+      {
+        case BatchArgument::Kind::Slot:
+          return slots[argument.slots[0]];
+        case BatchArgument::Kind::SlotList:
+          {
+            c10::List <at::Tensor> list;
+            list.reserve (argument.slots.size ());
+
+            for (guint slot : argument.slots)
+              list.push_back (slots[slot].toTensor ());
+
+            return c10::IValue (std::move (list));
+          }
+        case BatchArgument::Kind::Constant:
+        default:
+          return argument.constant;
+      }
+  }
+
+  c10::OperatorHandle
+  find_operator (const char *name, const char *overload_name)
+  {
+    std::string qualified_name (name);
+
+    /* Most callers will only want the ATen operators, so
+     * allow the namespace to be left out */
+    if (qualified_name.find ("::") == std::string::npos)
+      qualified_name = "aten::" + qualified_name;
+
+    auto handle = c10::Dispatcher::singleton ().findSchema ({
+      qualified_name,
+      overload_name != NULL ? overload_name : ""
+    });
+
+    if (!handle.has_value ())
+      throw std::invalid_argument ("No operator named " + qualified_name +
+                                   (overload_name != NULL && *overload_name != '\0' ?
+                                    std::string (".") + overload_name :
+                                    std::string ()));
+
+    return *handle;
+  }
+}
+
+/**
+ * torch_op_batch_add_input:
+ * @batch: A #TorchOpBatch
+ * @tensor: (transfer none): A #TorchTensor to use as an input
+ * @out_slot: (out): Return location for the slot that refers to @tensor
+ * @error: A #GError
+ *
+ * Add a new slot to @batch holding @tensor, which ops recorded later
+ * can refer to as an argument. The slot can be pointed at a different
+ * tensor between runs with %torch_op_batch_set_input.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set on failure.
+ */
+gboolean
+torch_op_batch_add_input (TorchOpBatch  *batch,
+                          TorchTensor   *tensor,
+                          guint         *out_slot,
+                          GError       **error)
+{
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+
+  g_return_val_if_fail (TORCH_IS_OP_BATCH (batch), FALSE);
+  g_return_val_if_fail (TORCH_IS_TENSOR (tensor), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (!torch_tensor_init_internal (tensor, error))
+    return FALSE;
+
+  priv->slots->emplace_back (torch_tensor_get_real_tensor (tensor));
+  priv->slot_is_input->push_back (true);
+
+  if (out_slot != NULL)
+    *out_slot = priv->slots->size () - 1;
+
+  return TRUE;
+}
+
+/**
+ * torch_op_batch_set_input:
+ * @batch: A #TorchOpBatch
+ * @slot: The slot returned by %torch_op_batch_add_input
+ * @tensor: (transfer none): A #TorchTensor to use as the input in @slot
+ * @error: A #GError
+ *
+ * Replace the tensor in the input slot @slot, so that the same
+ * recorded sequence of ops can be run again on new data.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set on failure.
+ */
+gboolean
+torch_op_batch_set_input (TorchOpBatch  *batch,
+                          guint          slot,
+                          TorchTensor   *tensor,
+                          GError       **error)
+{
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+
+  g_return_val_if_fail (TORCH_IS_OP_BATCH (batch), FALSE);
+  g_return_val_if_fail (TORCH_IS_TENSOR (tensor), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (slot >= priv->slots->size () || !(*priv->slot_is_input)[slot])
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   "Slot %u is not an input slot",
+                   slot);
+      return FALSE;
+    }
+
+  if (!torch_tensor_init_internal (tensor, error))
+    return FALSE;
+
+  (*priv->slots)[slot] = torch_tensor_get_real_tensor (tensor);
+  return TRUE;
+}
+
+/**
+ * torch_op_batch_add_op:
+ * @batch: A #TorchOpBatch
+ * @name: The name of the operator, for instance "add" or "aten::add".
+ * @overload_name: (nullable): The name of the overload, for instance "Tensor".
+ * @arguments: A #GVariant of type "av" with the arguments
+ * @out_first_output_slot: (out) (optional): Return location for the
+ *                         slot of the first output of the op.
+ * @out_n_outputs: (out) (optional): Return location for the number of
+ *                 outputs of the op.
+ * @error: A #GError
+ *
+ * Record a call to the operator @name in @batch, to be executed by
+ * %torch_op_batch_run. Each output of the operator is given a new
+ * slot, numbered consecutively from @out_first_output_slot.
+ *
+ * The arguments are given in the order of the operator schema. An
+ * argument of type "u" refers to the tensor in that slot and "au" to
+ * a list of tensors in those slots. Other values are passed as
+ * constants: "b" for booleans, "i" and "x" for integers, "d" for
+ * floating point numbers, "s" for strings, "ax" and "ad" for lists
+ * and "()" for None. Trailing arguments may be left out if the
+ * schema has a default value for them.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set on failure.
+ */
+gboolean
+torch_op_batch_add_op (TorchOpBatch  *batch,
+                       const char    *name,
+                       const char    *overload_name,
+                       GVariant      *arguments,
+                       guint         *out_first_output_slot,
+                       guint         *out_n_outputs,
+                       GError       **error)
+{
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+
+  g_return_val_if_fail (TORCH_IS_OP_BATCH (batch), FALSE);
+  g_return_val_if_fail (name != NULL, FALSE);
+  g_return_val_if_fail (g_variant_is_of_type (arguments, G_VARIANT_TYPE ("av")), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  try
+    {
+      c10::OperatorHandle          handle = find_operator (name, overload_name);
+      c10::FunctionSchema const   &schema = handle.schema ();
+      std::vector <BatchArgument>  batch_arguments;
+      size_t                       n_arguments = g_variant_n_children (arguments);
+
+      if (n_arguments > schema.arguments ().size ())
+        throw std::invalid_argument (schema.name () + " takes at most " +
+                                     std::to_string (schema.arguments ().size ()) +
+                                     " arguments");
+
+      batch_arguments.reserve (schema.arguments ().size ());
+
+      for (size_t i = 0; i < n_arguments; ++i)
+        {
+          g_autoptr (GVariant) child = g_variant_get_child_value (arguments, i);
+          g_autoptr (GVariant) value = g_variant_get_variant (child);
+
+          batch_arguments.push_back (batch_argument_from_variant (value, priv->slots->size ()));
+        }
+
+      for (size_t i = n_arguments; i < schema.arguments ().size (); ++i)
+        {
+          c10::Argument const &argument = schema.arguments ()[i];
+
+          if (!argument.default_value ().has_value ())
+            throw std::invalid_argument ("Argument '" + argument.name () + "' of " +
+                                         schema.name () + " has no default value");
+
+          batch_arguments.push_back (constant_argument (*argument.default_value ()));
+        }
+
+      guint first_output_slot = priv->slots->size ();
+      guint n_outputs = schema.returns ().size ();
+
+      priv->ops->push_back (BatchOp { handle, std::move (batch_arguments), first_output_slot, n_outputs });
+      priv->slots->resize (first_output_slot + n_outputs);
+      priv->slot_is_input->resize (first_output_slot + n_outputs, false);
+
+      if (out_first_output_slot != NULL)
+        *out_first_output_slot = first_output_slot;
+
+      if (out_n_outputs != NULL)
+        *out_n_outputs = n_outputs;
+
+      return TRUE;
+    }
+  catch (std::invalid_argument const &e)
+    {
+      return (gboolean) (set_error_from_exception (e,
+                                                   G_IO_ERROR,
+                                                   G_IO_ERROR_INVALID_ARGUMENT,
+                                                   error));
+    }
+  catch (std::exception const &e)
+    {
+      return (gboolean) (set_error_from_exception (e,
+                                                   G_IO_ERROR,
+                                                   G_IO_ERROR_FAILED,
+                                                   error));
+    }
+}
+
+/**
+ * torch_op_batch_get_n_slots:
+ * @batch: A #TorchOpBatch
+ *
+ * Get the number of input and output slots in @batch.
+ *
+ * Returns: The number of slots.
+ */
+guint
+torch_op_batch_get_n_slots (TorchOpBatch *batch)
+{
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+
+  g_return_val_if_fail (TORCH_IS_OP_BATCH (batch), 0);
+
+  return priv->slots->size ();
+}
+
+namespace
+{
+  gboolean
+  resolve_requested_slots (TorchOpBatchPrivate  *priv,
+                           GArray               *output_slots,
+                           std::vector <guint>  &requested_slots,
+                           GError              **error)
+  {
+    if (output_slots != NULL)
+      {
+        requested_slots.assign (&g_array_index (output_slots, guint, 0),
+                                &g_array_index (output_slots, guint, 0) + output_slots->len);
+
+        for (guint slot : requested_slots)
+          {
+            if (slot >= priv->slots->size ())
+              {
+                g_set_error (error,
+                             G_IO_ERROR,
+                             G_IO_ERROR_INVALID_ARGUMENT,
+                             "Slot %u does not exist",
+                             slot);
+                return FALSE;
+              }
+          }
+      }
+    else if (!priv->ops->empty ())
+      {
+        BatchOp const &last_op = priv->ops->back ();
+
+        for (guint i = 0; i < last_op.n_outputs; ++i)
+          requested_slots.push_back (last_op.first_output_slot + i);
+      }
+
+    return TRUE;
+  }
+
+  void
+  clear_output_slots (TorchOpBatchPrivate *priv)
+  {
+    std::vector <c10::IValue> &slots = *priv->slots;
+
+    for (size_t i = 0; i < slots.size (); ++i)
+      if (!(*priv->slot_is_input)[i])
+        slots[i] = c10::IValue ();
+  }
+
+  GPtrArray *
+  run_batch_ops (TorchOpBatchPrivate       *priv,
+                 std::vector <guint> const &requested_slots)
+  {
+    std::vector <c10::IValue> &slots = *priv->slots;
+    torch::jit::Stack          stack;
+
+    for (BatchOp const &op : *priv->ops)
+      {
+        stack.clear ();
+        stack.reserve (op.arguments.size ());
+
+        for (BatchArgument const &argument : op.arguments)
+          stack.push_back (resolve_batch_argument (argument, slots));
+
+        op.handle.callBoxed (&stack);
+
+        if (stack.size () != op.n_outputs)
+          throw std::runtime_error (op.handle.schema ().name () + " returned " +
+                                    std::to_string (stack.size ()) + " values, expected " +
+                                    std::to_string (op.n_outputs));
+
+        for (guint i = 0; i < op.n_outputs; ++i)
+          slots[op.first_output_slot + i] = std::move (stack[i]);
+      }
+
+    g_autoptr (GPtrArray) outputs = g_ptr_array_new_full (requested_slots.size (), g_object_unref);
+
+    for (guint slot : requested_slots)
+      {
+        if (!slots[slot].isTensor ())
+          throw std::invalid_argument ("Slot " + std::to_string (slot) + " does not hold a tensor");
+
+        g_ptr_array_add (outputs, torch_tensor_new_from_real_tensor (slots[slot].toTensor ()));
+      }
+
+    return static_cast <GPtrArray *> (g_steal_pointer (&outputs));
+  }
+
+  /* Runs the batch and always clears the intermediate results,
+   * even if one of the ops threw. */
+  GPtrArray *
+  run_batch_ops_and_clear (TorchOpBatchPrivate       *priv,
+                           std::vector <guint> const &requested_slots,
+                           GError                   **error)
+  {
+    try
+      {
+        GPtrArray *outputs = run_batch_ops (priv, requested_slots);
+
+        clear_output_slots (priv);
+        return outputs;
+      }
+    catch (std::invalid_argument const &e)
+      {
+        clear_output_slots (priv);
+        return reinterpret_cast <GPtrArray *> (set_error_from_exception (e,
+                                                                         G_IO_ERROR,
+                                                                         G_IO_ERROR_INVALID_ARGUMENT,
+                                                                         error));
+      }
+    catch (std::exception const &e)
+      {
+        clear_output_slots (priv);
+        return reinterpret_cast <GPtrArray *> (set_error_from_exception (e,
+                                                                         G_IO_ERROR,
+                                                                         G_IO_ERROR_FAILED,
+                                                                         error));
+      }
+  }
+}
+
+/**
+ * torch_op_batch_run:
+ * @batch: A #TorchOpBatch
+ * @output_slots: (element-type guint) (nullable): A #GArray of the slots
+ *                to return, or %NULL for the outputs of the last op.
+ * @error: A #GError
+ *
+ * Run all the ops recorded in @batch in order, without returning to
+ * the caller in between. Only the tensors in @output_slots are wrapped
+ * in a #TorchTensor, the intermediate results are released once the
+ * run is complete.
+ *
+ * Returns: (transfer full) (element-type TorchTensor): A #GPtrArray of
+ *          #TorchTensor, one for each slot in @output_slots, or %NULL
+ *          with @error set on failure.
+ */
+GPtrArray *
+torch_op_batch_run (TorchOpBatch  *batch,
+                    GArray        *output_slots,
+                    GError       **error)
+{
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+  std::vector <guint>  requested_slots;
+
+  g_return_val_if_fail (TORCH_IS_OP_BATCH (batch), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!resolve_requested_slots (priv, output_slots, requested_slots, error))
+    return NULL;
+
+  return run_batch_ops_and_clear (priv, requested_slots, error);
+}
+
+/**
+ * torch_op_batch_run_async:
+ * @batch: A #TorchOpBatch
+ * @output_slots: (element-type guint) (nullable): A #GArray of the slots
+ *                to return, or %NULL for the outputs of the last op.
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the batch has run.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronous version of %torch_op_batch_run. The batch is submitted
+ * to the libtorch inter-op thread pool, so independent batches run
+ * concurrently, up to the number of threads set with
+ * %torch_runtime_set_num_interop_threads. Each op may still use the
+ * intra-op threads.
+ *
+ * @batch must not be modified or run again until @callback has been
+ * called. Cancelling @cancellable only has an effect if the batch has
+ * not started running yet.
+ */
+void
+torch_op_batch_run_async (TorchOpBatch        *batch,
+                          GArray              *output_slots,
+                          GCancellable        *cancellable,
+                          GAsyncReadyCallback  callback,
+                          gpointer             user_data)
+{
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+  g_autoptr (GTask)    task = NULL;
+  g_autoptr (GError)   error = NULL;
+  std::vector <guint>  requested_slots;
+
+  g_return_if_fail (TORCH_IS_OP_BATCH (batch));
+
+  task = g_task_new (batch, cancellable, callback, user_data);
+  g_task_set_source_tag (task, reinterpret_cast <gpointer> (torch_op_batch_run_async));
+
+  if (!resolve_requested_slots (priv, output_slots, requested_slots, &error))
+    {
+      g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&error)));
+      return;
+    }
+
+  /* The task holds a reference on the batch as its source object, so
+   * priv stays valid until the task is released on the worker thread */
+  at::launch ([task = static_cast <GTask *> (g_object_ref (task)), priv, requested_slots]() {
+    g_autoptr (GError) run_error = NULL;
+    GPtrArray *outputs = NULL;
+
+    torch_runtime_apply_cpu_affinity_to_current_thread ();
+
+    if (!g_task_return_error_if_cancelled (task))
+      {
+        outputs = run_batch_ops_and_clear (priv, requested_slots, &run_error);
+
+        if (outputs != NULL)
+          g_task_return_pointer (task, outputs, reinterpret_cast <GDestroyNotify> (g_ptr_array_unref));
+        else
+          g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&run_error)));
+      }
+
+    g_object_unref (task);
+  });
+}
+
+/**
+ * torch_op_batch_run_finish:
+ * @batch: A #TorchOpBatch
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %torch_op_batch_run_async.
+ *
+ * Returns: (transfer full) (element-type TorchTensor): A #GPtrArray of
+ *          #TorchTensor, one for each requested slot, or %NULL with
+ *          @error set on failure.
+ */
+GPtrArray *
+torch_op_batch_run_finish (TorchOpBatch  *batch,
+                           GAsyncResult  *result,
+                           GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, batch), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        reinterpret_cast <gpointer> (torch_op_batch_run_async), NULL);
+
+  return static_cast <GPtrArray *> (g_task_propagate_pointer (G_TASK (result), error));
+}
+
+static void
+torch_op_batch_init (TorchOpBatch *batch)
+{
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+
+  priv->ops = new std::vector <BatchOp> ();
+  priv->slots = new std::vector <c10::IValue> ();
+  priv->slot_is_input = new std::vector <bool> ();
+}
+
+static void
+torch_op_batch_finalize (GObject *object)
+{
+  TorchOpBatch *batch = TORCH_OP_BATCH (object);
+  TorchOpBatchPrivate *priv = TORCH_OP_BATCH_GET_PRIVATE (batch);
+
+  delete priv->ops;
+  delete priv->slots;
+  delete priv->slot_is_input;
+
+  G_OBJECT_CLASS (torch_op_batch_parent_class)->finalize (object);
+}
+
+static void
+torch_op_batch_class_init (TorchOpBatchClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = torch_op_batch_finalize;
+}
+
+/**
+ * torch_op_batch_new:
+ *
+ * Create a new, empty #TorchOpBatch. Add input tensors with
+ * %torch_op_batch_add_input and the ops to apply to them with
+ * %torch_op_batch_add_op, then call %torch_op_batch_run to execute
+ * all of them at once. This avoids going back and forth between the
+ * caller and the library for each individual op, which matters when
+ * the ops are small and called from a language binding.
+ *
+ * A #TorchOpBatch is not thread-safe.
+ *
+ * Returns: (transfer full): A new #TorchOpBatch
+ */
+TorchOpBatch *
+torch_op_batch_new (void)
+{
+  return static_cast <TorchOpBatch *> (g_object_new (TORCH_TYPE_OP_BATCH, NULL));
+}
@@ -0,0 +1,71 @@
+/*
+ * torch-gobject/torch-op-batch.h
+ *
+ * Record a sequence of operator calls and run them in one go.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <glib-object.h>
+
+#include <torch-gobject/torch-tensor.h>
+
+G_BEGIN_DECLS
+
+#define TORCH_TYPE_OP_BATCH torch_op_batch_get_type ()
+G_DECLARE_FINAL_TYPE (TorchOpBatch, torch_op_batch, TORCH, OP_BATCH, GObject)
+
+TorchOpBatch * torch_op_batch_new (void);
+
+gboolean torch_op_batch_add_input (TorchOpBatch  *batch,
+                                   TorchTensor   *tensor,
+                                   guint         *out_slot,
+                                   GError       **error);
+
+gboolean torch_op_batch_set_input (TorchOpBatch  *batch,
+                                   guint          slot,
+                                   TorchTensor   *tensor,
+                                   GError       **error);
+
+gboolean torch_op_batch_add_op (TorchOpBatch  *batch,
+                                const char    *name,
+                                const char    *overload_name,
+                                GVariant      *arguments,
+                                guint         *out_first_output_slot,
+                                guint         *out_n_outputs,
+                                GError       **error);
+
+guint torch_op_batch_get_n_slots (TorchOpBatch *batch);
+
+GPtrArray * torch_op_batch_run (TorchOpBatch  *batch,
+                                GArray        *output_slots,
+                                GError       **error);
+
+void torch_op_batch_run_async (TorchOpBatch        *batch,
+                               GArray              *output_slots,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data);
+
+GPtrArray * torch_op_batch_run_finish (TorchOpBatch  *batch,
+                                       GAsyncResult  *result,
+                                       GError       **error);
+
+G_END_DECLS
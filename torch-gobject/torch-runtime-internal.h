@@ -0,0 +1,31 @@
+/*
+ * torch-gobject/torch-runtime-internal.h
+ *
+ * Process-wide configuration of the libtorch runtime, internal functions.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <torch-gobject/torch-runtime.h>
+
+/* Pin the calling thread to the CPUs set with
+ * torch_runtime_set_cpu_affinity, if they changed since the last
+ * time it was called on this thread. This is cheap enough to call
+ * before every job on a worker thread. */
+void torch_runtime_apply_cpu_affinity_to_current_thread (void);
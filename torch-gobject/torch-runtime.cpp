@@ -0,0 +1,518 @@
+/*
+ * torch-gobject/torch-runtime.cpp
+ *
+ * Process-wide configuration of the libtorch runtime.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <ATen/Parallel.h>
+
+#include <gio/gio.h>
+
+#include <torch-gobject/torch-runtime.h>
+#include <torch-gobject/torch-runtime-internal.h>
+#include <torch-gobject/torch-util.h>
+
+struct _TorchRuntime
+{
+  GObject parent_instance;
+};
+
+typedef struct _TorchRuntimePrivate
+{
+  char *cpu_affinity;
+} TorchRuntimePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (TorchRuntime, torch_runtime, G_TYPE_OBJECT)
+#define TORCH_RUNTIME_GET_PRIVATE(a) static_cast <TorchRuntimePrivate *> (torch_runtime_get_instance_private ((a)))
+
+enum {
+  PROP_0,
+  PROP_NUM_THREADS,
+  PROP_NUM_INTEROP_THREADS,
+  PROP_CPU_AFFINITY,
+  PROP_PARALLEL_INFO,
+  NPROPS
+};
+
+static GParamSpec *torch_runtime_props [NPROPS] = { NULL, };
+
+#ifdef __linux__
+namespace
+{
+  /* The mask is shared by every thread that libtorch or torch-gobject
+   * runs work on. Each thread compares the generation against the one
+   * it last applied, so that it only makes the system call when the
+   * mask actually changed. Generation 0 means that no mask was set. */
+  struct CpuAffinityState
+  {
+    std::mutex          mutex;
+    cpu_set_t           mask;
+    cpu_set_t           original_mask;
+    std::atomic <guint> generation;
+
+    CpuAffinityState () :
+      generation (0)
+    {
+      CPU_ZERO (&original_mask);
+      sched_getaffinity (0, sizeof (cpu_set_t), &original_mask);
+      mask = original_mask;
+    }
+  };
+
+  CpuAffinityState &
+  cpu_affinity_state (void)
+  {
+    static CpuAffinityState state;
+    return state;
+  }
+
+  thread_local guint applied_cpu_affinity_generation = 0;
+
+  gboolean
+  parse_cpu_list (const char  *cpu_list,
+                  cpu_set_t   *mask,
+                  GError     **error)
+  {
+    g_auto (GStrv) ranges = g_strsplit (cpu_list, ",", -1);
+
+    CPU_ZERO (mask);
+
+    for (char **range = ranges; *range != NULL; ++range)
+      {
+        g_auto (GStrv)     bounds = g_strsplit (g_strstrip (*range), "-", 2);
+        g_autoptr (GError) parse_error = NULL;
+        guint64            first, last;
+
+        if (!g_ascii_string_to_unsigned (bounds[0], 10, 0, CPU_SETSIZE - 1, &first, &parse_error))
+          {
+            g_set_error (error,
+                         G_IO_ERROR,
+                         G_IO_ERROR_INVALID_ARGUMENT,
+                         "Invalid CPU list '%s': %s",
+                         cpu_list,
+                         parse_error->message);
+            return FALSE;
+          }
+
+        last = first;
+
+        if (bounds[1] != NULL &&
+            !g_ascii_string_to_unsigned (bounds[1], 10, first, CPU_SETSIZE - 1, &last, &parse_error))
+          {
+            g_set_error (error,
+                         G_IO_ERROR,
+                         G_IO_ERROR_INVALID_ARGUMENT,
+                         "Invalid CPU list '%s': %s",
+                         cpu_list,
+                         parse_error->message);
+            return FALSE;
+          }
+
+        for (guint64 cpu = first; cpu <= last; ++cpu)
+          CPU_SET (cpu, mask);
+      }
+
+    return TRUE;
+  }
+}
+#endif
+
+void
+torch_runtime_apply_cpu_affinity_to_current_thread (void)
+{
+#ifdef __linux__
+  CpuAffinityState &state = cpu_affinity_state ();
+  guint generation = state.generation.load (std::memory_order_acquire);
+
+  if (generation == applied_cpu_affinity_generation)
+    return;
+
+  cpu_set_t mask;
+
+  {
+    std::lock_guard <std::mutex> lock (state.mutex);
+    mask = state.mask;
+    generation = state.generation.load (std::memory_order_relaxed);
+  }
+
+  pthread_setaffinity_np (pthread_self (), sizeof (cpu_set_t), &mask);
+  applied_cpu_affinity_generation = generation;
+#endif
+}
+
+/**
+ * torch_runtime_get_num_threads:
+ * @runtime: A #TorchRuntime
+ *
+ * Get the number of threads used to parallelize a single operation.
+ *
+ * Returns: The number of intra-op threads.
+ */
+gint
+torch_runtime_get_num_threads (TorchRuntime *runtime)
+{
+  g_return_val_if_fail (TORCH_IS_RUNTIME (runtime), 0);
+
+  return at::get_num_threads ();
+}
+
+/**
+ * torch_runtime_set_num_threads:
+ * @runtime: A #TorchRuntime
+ * @n_threads: The number of threads, at least 1.
+ *
+ * Set the number of threads used to parallelize a single operation.
+ * This applies to the whole process.
+ */
+void
+torch_runtime_set_num_threads (TorchRuntime *runtime,
+                               gint          n_threads)
+{
+  g_return_if_fail (TORCH_IS_RUNTIME (runtime));
+  g_return_if_fail (n_threads > 0);
+
+  if (at::get_num_threads () == n_threads)
+    return;
+
+  at::set_num_threads (n_threads);
+  g_object_notify_by_pspec (G_OBJECT (runtime), torch_runtime_props[PROP_NUM_THREADS]);
+}
+
+/**
+ * torch_runtime_get_num_interop_threads:
+ * @runtime: A #TorchRuntime
+ *
+ * Get the number of threads used to run independent operations
+ * concurrently, for instance by %torch_op_batch_run_async.
+ *
+ * Returns: The number of inter-op threads.
+ */
+gint
+torch_runtime_get_num_interop_threads (TorchRuntime *runtime)
+{
+  g_return_val_if_fail (TORCH_IS_RUNTIME (runtime), 0);
+
+  return at::get_num_interop_threads ();
+}
+
+/**
+ * torch_runtime_set_num_interop_threads:
+ * @runtime: A #TorchRuntime
+ * @n_threads: The number of threads, at least 1.
+ * @error: A #GError
+ *
+ * Set the number of threads used to run independent operations
+ * concurrently. libtorch only allows this to be set once, before
+ * any inter-op work has been started.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set on failure.
+ */
+gboolean
+torch_runtime_set_num_interop_threads (TorchRuntime  *runtime,
+                                       gint           n_threads,
+                                       GError       **error)
+{
+  g_return_val_if_fail (TORCH_IS_RUNTIME (runtime), FALSE);
+  g_return_val_if_fail (n_threads > 0, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (!call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, FALSE, [&]() -> gboolean {
+        at::set_num_interop_threads (n_threads);
+        return TRUE;
+      }))
+    return FALSE;
+
+  g_object_notify_by_pspec (G_OBJECT (runtime), torch_runtime_props[PROP_NUM_INTEROP_THREADS]);
+  return TRUE;
+}
+
+/**
+ * torch_runtime_get_cpu_affinity:
+ * @runtime: A #TorchRuntime
+ *
+ * Get the CPUs that the libtorch and torch-gobject worker threads are
+ * restricted to, as set by %torch_runtime_set_cpu_affinity.
+ *
+ * Returns: (nullable): The CPU list, or %NULL if the threads are not
+ *          restricted.
+ */
+const char *
+torch_runtime_get_cpu_affinity (TorchRuntime *runtime)
+{
+  TorchRuntimePrivate *priv = TORCH_RUNTIME_GET_PRIVATE (runtime);
+
+  g_return_val_if_fail (TORCH_IS_RUNTIME (runtime), NULL);
+
+  return priv->cpu_affinity;
+}
+
+/**
+ * torch_runtime_set_cpu_affinity:
+ * @runtime: A #TorchRuntime
+ * @cpu_list: (nullable): A list of CPUs such as "0-3,8", or %NULL to
+ *            lift the restriction.
+ * @error: A #GError
+ *
+ * Restrict the calling thread and the torch-gobject worker threads
+ * to the CPUs in @cpu_list, in the format used by taskset(1). The
+ * worker threads pick up the new mask before the next job they run.
+ *
+ * Threads that libtorch creates later inherit the mask of the thread
+ * that creates them, but libtorch gives no way to run code on each
+ * of its existing intra-op threads, so pinning those is best-effort:
+ * a parallel loop is run to apply the mask on whichever of them pick
+ * up a piece of it, and it is skipped when called from inside a
+ * parallel region. For a reliable result, call this before running
+ * any operations, or before changing the number of threads with
+ * %torch_runtime_set_num_threads. Inter-op threads are only created
+ * once, so this should be called before any inter-op work is started.
+ *
+ * This is only supported on Linux.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set on failure.
+ */
+gboolean
+torch_runtime_set_cpu_affinity (TorchRuntime  *runtime,
+                                const char    *cpu_list,
+                                GError       **error)
+{
+  TorchRuntimePrivate *priv = TORCH_RUNTIME_GET_PRIVATE (runtime);
+
+  g_return_val_if_fail (TORCH_IS_RUNTIME (runtime), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+#ifdef __linux__
+  CpuAffinityState &state = cpu_affinity_state ();
+  cpu_set_t         mask;
+
+  if (cpu_list == NULL)
+    mask = state.original_mask;
+  else if (!parse_cpu_list (cpu_list, &mask, error))
+    return FALSE;
+
+  if (CPU_COUNT (&mask) == 0)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   "CPU list '%s' does not contain any CPUs",
+                   cpu_list);
+      return FALSE;
+    }
+
+  {
+    std::lock_guard <std::mutex> lock (state.mutex);
+    state.mask = mask;
+    state.generation.fetch_add (1, std::memory_order_release);
+  }
+
+  torch_runtime_apply_cpu_affinity_to_current_thread ();
+
+  /* Which thread runs which chunk is up to the thread pool, so
+   * threads that are busy or slow to wake up may not get one. Inside
+   * a parallel region the loop would just run inline on this thread,
+   * which was already pinned above. */
+  if (!at::in_parallel_region ())
+    at::parallel_for (0, at::get_num_threads (), 1, [](int64_t begin, int64_t end) {
+      torch_runtime_apply_cpu_affinity_to_current_thread ();
+    });
+
+  g_clear_pointer (&priv->cpu_affinity, g_free);
+  priv->cpu_affinity = g_strdup (cpu_list);
+  g_object_notify_by_pspec (G_OBJECT (runtime), torch_runtime_props[PROP_CPU_AFFINITY]);
+
+  return TRUE;
+#else
+  g_set_error (error,
+               G_IO_ERROR,
+               G_IO_ERROR_NOT_SUPPORTED,
+               "Setting the CPU affinity is not supported on this platform");
+  return FALSE;
+#endif
+}
+
+/**
+ * torch_runtime_get_parallel_info:
+ * @runtime: A #TorchRuntime
+ *
+ * Get a human readable description of the parallelization settings
+ * and backends that libtorch was built with.
+ *
+ * Returns: (transfer full): The parallelization information.
+ */
+char *
+torch_runtime_get_parallel_info (TorchRuntime *runtime)
+{
+  g_return_val_if_fail (TORCH_IS_RUNTIME (runtime), NULL);
+
+  return g_strdup (at::get_parallel_info ().c_str ());
+}
+
+static void
+torch_runtime_init (TorchRuntime *runtime)
+{
+}
+
+static void
+torch_runtime_get_property (GObject      *object,
+                            unsigned int  prop_id,
+                            GValue       *value,
+                            GParamSpec   *pspec)
+{
+  TorchRuntime *runtime = TORCH_RUNTIME (object);
+
+  switch (prop_id)
+    {
+      case PROP_NUM_THREADS:
+        g_value_set_int (value, torch_runtime_get_num_threads (runtime));
+        break;
+      case PROP_NUM_INTEROP_THREADS:
+        g_value_set_int (value, torch_runtime_get_num_interop_threads (runtime));
+        break;
+      case PROP_CPU_AFFINITY:
+        g_value_set_string (value, torch_runtime_get_cpu_affinity (runtime));
+        break;
+      case PROP_PARALLEL_INFO:
+        g_value_take_string (value, torch_runtime_get_parallel_info (runtime));
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_runtime_set_property (GObject      *object,
+                            unsigned int  prop_id,
+                            const GValue *value,
+                            GParamSpec   *pspec)
+{
+  TorchRuntime *runtime = TORCH_RUNTIME (object);
+
+  switch (prop_id)
+    {
+      case PROP_NUM_THREADS:
+        torch_runtime_set_num_threads (runtime, g_value_get_int (value));
+        break;
+      case PROP_NUM_INTEROP_THREADS:
+        call_and_warn_about_gerror ("set property 'num-interop-threads'",
+                                    torch_runtime_set_num_interop_threads,
+                                    runtime,
+                                    g_value_get_int (value));
+        break;
+      case PROP_CPU_AFFINITY:
+        call_and_warn_about_gerror ("set property 'cpu-affinity'",
+                                    torch_runtime_set_cpu_affinity,
+                                    runtime,
+                                    g_value_get_string (value));
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_runtime_finalize (GObject *object)
+{
+  TorchRuntime *runtime = TORCH_RUNTIME (object);
+  TorchRuntimePrivate *priv = TORCH_RUNTIME_GET_PRIVATE (runtime);
+
+  g_clear_pointer (&priv->cpu_affinity, g_free);
+
+  G_OBJECT_CLASS (torch_runtime_parent_class)->finalize (object);
+}
+
+static void
+torch_runtime_class_init (TorchRuntimeClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->get_property = torch_runtime_get_property;
+  object_class->set_property = torch_runtime_set_property;
+  object_class->finalize = torch_runtime_finalize;
+
+  torch_runtime_props[PROP_NUM_THREADS] =
+    g_param_spec_int ("num-threads",
+                      "Number of Threads",
+                      "Number of threads used to parallelize a single operation",
+                      1,
+                      G_MAXINT,
+                      1,
+                      static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY));
+
+  torch_runtime_props[PROP_NUM_INTEROP_THREADS] =
+    g_param_spec_int ("num-interop-threads",
+                      "Number of Inter-op Threads",
+                      "Number of threads used to run independent operations concurrently",
+                      1,
+                      G_MAXINT,
+                      1,
+                      static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY));
+
+  torch_runtime_props[PROP_CPU_AFFINITY] =
+    g_param_spec_string ("cpu-affinity",
+                         "CPU Affinity",
+                         "List of CPUs that worker threads are restricted to, or NULL for no restriction",
+                         NULL,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY));
+
+  torch_runtime_props[PROP_PARALLEL_INFO] =
+    g_param_spec_string ("parallel-info",
+                         "Parallel Info",
+                         "Description of the parallelization settings of libtorch",
+                         NULL,
+                         static_cast <GParamFlags> (G_PARAM_READABLE));
+
+  g_object_class_install_properties (object_class,
+                                     NPROPS,
+                                     torch_runtime_props);
+}
+
+/**
+ * torch_runtime_get_default:
+ *
+ * Get the #TorchRuntime for this process. The settings on it apply
+ * to all of libtorch, so there is only ever one instance.
+ *
+ * Returns: (transfer none): The #TorchRuntime
+ */
+TorchRuntime *
+torch_runtime_get_default (void)
+{
+  static gsize         initialized = 0;
+  static TorchRuntime *runtime = NULL;
+
+  if (g_once_init_enter (&initialized))
+    {
+      runtime = static_cast <TorchRuntime *> (g_object_new (TORCH_TYPE_RUNTIME, NULL));
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return runtime;
+}
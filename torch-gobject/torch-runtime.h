@@ -0,0 +1,53 @@
+/*
+ * torch-gobject/torch-runtime.h
+ *
+ * Process-wide configuration of the libtorch runtime.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define TORCH_TYPE_RUNTIME torch_runtime_get_type ()
+G_DECLARE_FINAL_TYPE (TorchRuntime, torch_runtime, TORCH, RUNTIME, GObject)
+
+TorchRuntime * torch_runtime_get_default (void);
+
+gint torch_runtime_get_num_threads (TorchRuntime *runtime);
+
+void torch_runtime_set_num_threads (TorchRuntime *runtime,
+                                    gint          n_threads);
+
+gint torch_runtime_get_num_interop_threads (TorchRuntime *runtime);
+
+gboolean torch_runtime_set_num_interop_threads (TorchRuntime  *runtime,
+                                                gint           n_threads,
+                                                GError       **error);
+
+const char * torch_runtime_get_cpu_affinity (TorchRuntime *runtime);
+
+gboolean torch_runtime_set_cpu_affinity (TorchRuntime  *runtime,
+                                         const char    *cpu_list,
+                                         GError       **error);
+
+char * torch_runtime_get_parallel_info (TorchRuntime *runtime);
+
+G_END_DECLS
@@ -20,6 +20,8 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <utility>
+
 #include <gio/gio.h>
 
 #include <torch-gobject/torch-allocator.h>
@@ -29,6 +31,7 @@
 #include <torch-gobject/torch-util.h>
 
 #include <c10/core/Storage.h>
+#include <c10/core/StorageImpl.h>
 
 struct _TorchStorage
 {
@@ -158,12 +161,38 @@ torch_storage_get_data (TorchStorage  *storage,
   });
 }
 
+namespace {
+gboolean
+check_storage_is_on_cpu (c10::Storage const &storage, GError **error)
+{
+  if (storage.device_type () != c10::DeviceType::CPU)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Only storage on the CPU can be read as bytes");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+GBytes *
+copy_storage_to_bytes (c10::Storage const &storage)
+{
+  return g_bytes_new (storage.data <char> (), storage.nbytes ());
+}
+}
+
 /**
  * torch_storage_get_bytes:
  * @storage: A #TorchStorage
  * @error: A #GError
  *
- * Get the bytes stored by this #TorchStorage
+ * Get a snapshot of the bytes stored by this #TorchStorage. The
+ * data is copied, so later changes to the storage are not visible
+ * in the returned #GBytes. Use %torch_storage_peek_bytes to
+ * read the data without copying it.
  *
  * Returns: (transfer full): A #GBytes with the data set to the data
  *                           contained in this #TorchStorage or %NULL
@@ -178,15 +207,56 @@ torch_storage_get_bytes (TorchStorage  *storage,
   if (!torch_storage_init_internal (storage, error))
     return NULL;
 
+  if (!check_storage_is_on_cpu (*priv->internal, error))
+    return NULL;
+
   return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> GBytes * {
-    const size_t n_bytes = priv->internal->nbytes();
-    g_autofree char *data = static_cast <char *> (g_malloc (sizeof (char) * n_bytes));
+    return copy_storage_to_bytes (*priv->internal);
+  });
+}
 
-    // XXX: This assumes that memcpy is even possible on the pointer,
-    //      it may very well not be
-    memcpy (static_cast <gpointer> (data), priv->internal->data <char *> (), n_bytes * sizeof (char));
+/**
+ * torch_storage_peek_bytes:
+ * @storage: A #TorchStorage
+ * @error: A #GError
+ *
+ * Get the bytes stored by this #TorchStorage without copying them.
+ * The returned #GBytes refers directly to the memory of the storage
+ * and holds a reference to it, so it remains valid after @storage
+ * is destroyed. Changes made to the storage through tensors are
+ * visible through the returned #GBytes.
+ *
+ * Resizable storage may move its memory when it is resized, so the
+ * data of resizable storage is copied, as with %torch_storage_get_bytes.
+ *
+ * Returns: (transfer full): A #GBytes with the data contained in this
+ *                           #TorchStorage or %NULL with @error set
+ *                           on failure.
+ */
+GBytes *
+torch_storage_peek_bytes (TorchStorage  *storage,
+                          GError       **error)
+{
+  TorchStoragePrivate *priv = TORCH_STORAGE_GET_PRIVATE (storage);
 
-    return g_bytes_new_with_free_func (g_steal_pointer (&data), n_bytes, g_free, NULL);
+  if (!torch_storage_init_internal (storage, error))
+    return NULL;
+
+  if (!check_storage_is_on_cpu (*priv->internal, error))
+    return NULL;
+
+  return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> GBytes * {
+    if (priv->internal->resizable ())
+      return copy_storage_to_bytes (*priv->internal);
+
+    /* The copy of the storage holds a reference on the StorageImpl
+     * until the GBytes is released. */
+    return g_bytes_new_with_free_func (priv->internal->data <char> (),
+                                       priv->internal->nbytes (),
+                                       [](gpointer data) {
+                                         delete static_cast <c10::Storage *> (data);
+                                       },
+                                       new c10::Storage (*priv->internal));
   });
 }
 
@@ -213,6 +283,37 @@ data_ptr_from_data (gpointer data_ptr,
   return c10::DataPtr (data_ptr, data_ptr, destroy_func, c10::DeviceType::CPU);
 }
 
+/* The c10::StorageImpl only keeps a raw pointer to its allocator,
+ * which it uses again whenever it is resized, and tensors can keep
+ * the StorageImpl alive after the TorchStorage is gone. Storage
+ * allocated from a TorchAllocator holds a reference on it for as long
+ * as the StorageImpl lives, which costs nothing per allocation. */
+class AllocatorStorageImpl:
+  public c10::StorageImpl
+{
+  public:
+    AllocatorStorageImpl (TorchAllocator *allocator,
+                          size_t          n_bytes,
+                          bool            resizable) :
+      c10::StorageImpl (c10::StorageImpl::use_byte_size_t{},
+                        n_bytes,
+                        &torch_allocator_get_real_allocator (allocator),
+                        resizable),
+      allocator (static_cast <TorchAllocator *> (g_object_ref (allocator)))
+    {
+    }
+
+    ~AllocatorStorageImpl ()
+    {
+      /* Give the memory back before the allocator can go away */
+      set_data_ptr_noswap (c10::DataPtr ());
+      g_object_unref (allocator);
+    }
+
+  private:
+    TorchAllocator *allocator;
+};
+
 }
 
 static gboolean
@@ -238,10 +339,11 @@ torch_storage_initable_init (GInitable     *initable,
       }
     else if (priv->allocator)
       {
-        priv->internal = new c10::Storage (c10::Storage::use_byte_size_t{},
-                                           priv->n_bytes,
-                                           &torch_allocator_get_real_allocator (priv->allocator),
-                                           priv->resizable);
+        auto storage_impl = c10::make_intrusive <AllocatorStorageImpl> (priv->allocator,
+                                                                        priv->n_bytes,
+                                                                        priv->resizable);
+
+        priv->internal = new c10::Storage (std::move (storage_impl));
       }
     else
       {
@@ -250,8 +352,8 @@ torch_storage_initable_init (GInitable     *initable,
 
     /* Once we've constructed the internal, everything gets moved to
      * the internal storage (one canonical copy), so we can clear the construct
-     * properties that we had in the meantime */
-    g_clear_pointer (&priv->allocator, g_object_unref);
+     * properties that we had in the meantime. The allocator is kept
+     * for torch_storage_get_allocator. */
     priv->n_bytes = 0;
     priv->resizable = 0;
     return TRUE;
@@ -419,21 +521,188 @@ torch_storage_init_internal (TorchStorage  *storage,
   return TRUE;
 }
 
+TorchStorage *
+torch_storage_new_from_real_storage (c10::Storage const &real_storage)
+{
+  g_autoptr (TorchStorage) storage = static_cast <TorchStorage *> (g_object_new (TORCH_TYPE_STORAGE, NULL));
+  TorchStoragePrivate *priv = TORCH_STORAGE_GET_PRIVATE (storage);
+
+  g_assert (priv->internal == NULL);
+  priv->internal = new c10::Storage (real_storage);
+
+  return static_cast <TorchStorage *> (g_steal_pointer (&storage));
+}
+
+/**
+ * torch_storage_new_from_mapped_file:
+ * @file: A #GFile to map
+ * @offset: The offset in bytes into @file where the storage starts
+ * @length: The size of the storage in bytes, or 0 to map until the end of @file
+ * @writable: Whether the storage can be written to
+ * @error: A #GError
+ *
+ * Create a new #TorchStorage backed by a memory mapping of @file,
+ * as opposed to reading its contents into memory. Pages are only
+ * read from disk when they are first accessed and are shared with
+ * the page cache, so several processes mapping the same weights only
+ * need one copy of them in memory. The mapping is released when the
+ * last tensor using the storage is destroyed.
+ *
+ * If @writable is %TRUE the storage is mapped privately, so writes
+ * to it are not written back to @file or seen by other processes.
+ * Otherwise writing to the storage will crash the program.
+ *
+ * Only files with a local path can be mapped. The storage is not
+ * resizable.
+ *
+ * Returns: (transfer full): A new #TorchStorage or %NULL with
+ *          @error set on failure.
+ */
+TorchStorage *
+torch_storage_new_from_mapped_file (GFile     *file,
+                                    goffset    offset,
+                                    gsize      length,
+                                    gboolean   writable,
+                                    GError   **error)
+{
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  g_autofree char *path = g_file_get_path (file);
+
+  if (path == NULL)
+    {
+      g_autofree char *uri = g_file_get_uri (file);
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Cannot map %s, it does not have a local path",
+                   uri);
+      return NULL;
+    }
+
+  g_autoptr (GMappedFile) mapped_file = g_mapped_file_new (path, writable, error);
+
+  if (mapped_file == NULL)
+    return NULL;
+
+  const gsize file_length = g_mapped_file_get_length (mapped_file);
+
+  if (offset < 0 || static_cast <guint64> (offset) > file_length)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   "Offset %" G_GINT64_FORMAT " is outside of %s",
+                   static_cast <gint64> (offset),
+                   path);
+      return NULL;
+    }
+
+  if (length == 0)
+    length = file_length - offset;
+
+  if (length > file_length - offset)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   "Cannot map %" G_GSIZE_FORMAT " bytes at offset %" G_GINT64_FORMAT " of %s, "
+                   "it is only %" G_GSIZE_FORMAT " bytes long",
+                   length,
+                   static_cast <gint64> (offset),
+                   path,
+                   file_length);
+      return NULL;
+    }
+
+  return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> TorchStorage * {
+    char         *data = g_mapped_file_get_contents (mapped_file) + offset;
+    c10::DataPtr  data_ptr (data,
+                            mapped_file,
+                            reinterpret_cast <c10::DeleterFnPtr> (g_mapped_file_unref),
+                            c10::DeviceType::CPU);
+
+    /* The DataPtr owns the reference to the mapped file from here on
+     * and unmaps it when the last tensor using it goes away, or when
+     * constructing the storage fails. */
+    g_steal_pointer (&mapped_file);
+
+    c10::Storage real_storage (c10::Storage::use_byte_size_t{},
+                               length,
+                               std::move (data_ptr),
+                               nullptr,
+                               false);
+
+    return torch_storage_new_from_real_storage (real_storage);
+  });
+}
+
+/**
+ * torch_storage_new_with_fixed_data:
+ * @data: A #GBytes with the data for the storage
+ * @error: A #GError
+ *
+ * Create a new #TorchStorage which uses the memory of @data directly,
+ * without copying it. The storage holds a reference on @data until
+ * the last tensor using it is destroyed, so @data may come from a
+ * #GResource or a memory mapping.
+ *
+ * The storage is not resizable. Since #GBytes is immutable, tensors
+ * using the storage must not be modified in place.
+ *
+ * Returns: (transfer full): A new #TorchStorage or %NULL with
+ *          @error set on failure.
+ */
 TorchStorage *
 torch_storage_new_with_fixed_data (GBytes  *data,
                                    GError **error)
 {
+  g_return_val_if_fail (data != NULL, NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  return static_cast <TorchStorage *> (g_initable_new (TORCH_TYPE_STORAGE,
-                                                       NULL,
-                                                       error,
-                                                       "n-bytes", g_bytes_get_size (data),
-                                                       "resizable", FALSE,
-                                                       "allocator", NULL,
-                                                       NULL));
+  return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> TorchStorage * {
+    gsize    n_bytes = 0;
+    gpointer bytes_data = const_cast <gpointer> (g_bytes_get_data (data, &n_bytes));
+
+    g_autoptr (GBytes) owned_data = g_bytes_ref (data);
+    c10::DataPtr       data_ptr (bytes_data,
+                                 owned_data,
+                                 reinterpret_cast <c10::DeleterFnPtr> (g_bytes_unref),
+                                 c10::DeviceType::CPU);
+
+    /* The DataPtr owns the reference to the bytes from here on and
+     * drops it when the last tensor using the storage goes away, or
+     * when constructing the storage fails. */
+    g_steal_pointer (&owned_data);
+
+    c10::Storage real_storage (c10::Storage::use_byte_size_t{},
+                               n_bytes,
+                               std::move (data_ptr),
+                               nullptr,
+                               false);
+
+    return torch_storage_new_from_real_storage (real_storage);
+  });
 }
 
+/**
+ * torch_storage_new_with_allocator:
+ * @size_bytes: The size of the storage in bytes
+ * @allocator: A #TorchAllocator to allocate the storage with
+ * @resizable: Whether the storage can be resized
+ * @error: A #GError
+ *
+ * Create a new #TorchStorage of @size_bytes, with its memory
+ * allocated by @allocator. The underlying storage keeps a
+ * reference to @allocator until the last tensor using it is gone, so that a caching allocator created with
+ * %torch_allocator_new_caching can be shared between many storages,
+ * and tensors created from the storage can still be resized after
+ * the storage itself is released.
+ *
+ * Returns: (transfer full): A new #TorchStorage or %NULL with
+ *          @error set on failure.
+ */
 TorchStorage *
 torch_storage_new_with_allocator (size_t           size_bytes,
                                   TorchAllocator  *allocator,
@@ -442,10 +711,10 @@ torch_storage_new_with_allocator (size_t           size_bytes,
 {
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  return static_cast <TorchStorage *> (g_initable_new (TORCH_TYPE_ALLOCATOR,
+  return static_cast <TorchStorage *> (g_initable_new (TORCH_TYPE_STORAGE,
                                                        NULL,
                                                        error,
-                                                       "n-bytes", size_bytes,
+                                                       "n-bytes", static_cast <guint64> (size_bytes),
                                                        "resizable", resizable,
                                                        "allocator", allocator,
                                                        NULL));
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <torch-gobject/torch-allocator.h>
 
@@ -30,9 +31,10 @@ G_BEGIN_DECLS
 #define TORCH_TYPE_STORAGE torch_storage_get_type ()
 G_DECLARE_FINAL_TYPE (TorchStorage, torch_storage, TORCH, STORAGE, GObject)
 
-TorchStorage * torch_storage_new_with_allocator (size_t          size_bytes,
-                                                 TorchAllocator *allocator,
-                                                 gboolean        resizable);
+TorchStorage * torch_storage_new_with_allocator (size_t           size_bytes,
+                                                 TorchAllocator  *allocator,
+                                                 gboolean         resizable,
+                                                 GError         **error);
 
 TorchStorage * torch_storage_new_with_reallocatable_data (size_t          size_bytes,
                                                           gpointer        data,
@@ -40,7 +42,14 @@ TorchStorage * torch_storage_new_with_reallocatable_data (size_t          size_b
                                                           TorchAllocator *allocator,
                                                           gboolean        resizable);
 
-TorchStorage * torch_storage_new_with_fixed_data (GBytes *data);
+TorchStorage * torch_storage_new_with_fixed_data (GBytes  *data,
+                                                  GError **error);
+
+TorchStorage * torch_storage_new_from_mapped_file (GFile     *file,
+                                                   goffset    offset,
+                                                   gsize      length,
+                                                   gboolean   writable,
+                                                   GError   **error);
 
 gboolean torch_storage_get_resizable (TorchStorage  *storage,
                                       gboolean      *out_resizable,
@@ -56,6 +65,9 @@ const gpointer torch_storage_get_data (TorchStorage  *storage,
 GBytes * torch_storage_get_bytes (TorchStorage  *storage,
                                   GError       **error);
 
+GBytes * torch_storage_peek_bytes (TorchStorage  *storage,
+                                   GError       **error);
+
 TorchAllocator * torch_storage_get_allocator (TorchStorage *storage);
 
 G_END_DECLS
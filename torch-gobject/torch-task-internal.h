@@ -0,0 +1,72 @@
+/*
+ * torch-gobject/torch-task-internal.h
+ *
+ * Run GTasks on the torch-gobject worker threads.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <functional>
+#include <utility>
+
+#include <gio/gio.h>
+
+#include <torch/torch.h>
+
+#include <torch-gobject/torch-tensor.h>
+
+/* Like g_task_run_in_thread, but runs @task_func on a thread pool
+ * that is separate from the one shared by all GTasks in the process,
+ * so that long-running tensor operations cannot starve I/O. If
+ * the task is cancelled before it starts running, @task_func is not
+ * called and the task returns G_IO_ERROR_CANCELLED. */
+void torch_task_run_in_worker_thread (GTask           *task,
+                                      GTaskThreadFunc  task_func);
+
+void torch_tensor_run_real_task_in_worker_thread (gpointer                          source_object,
+                                                  GCancellable                     *cancellable,
+                                                  GAsyncReadyCallback               callback,
+                                                  gpointer                          user_data,
+                                                  gpointer                          source_tag,
+                                                  std::function <at::Tensor ()>  &&func);
+
+/* Run @func on the worker threads and return the tensor it produces
+ * through a GTask. Anything @func captures must be owned by it, since
+ * it runs after the caller has returned. */
+template <typename Func>
+void
+torch_tensor_run_task_in_worker_thread (gpointer             source_object,
+                                        GCancellable        *cancellable,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data,
+                                        gpointer             source_tag,
+                                        Func               &&func)
+{
+  torch_tensor_run_real_task_in_worker_thread (source_object,
+                                               cancellable,
+                                               callback,
+                                               user_data,
+                                               source_tag,
+                                               std::function <at::Tensor ()> (std::forward <Func> (func)));
+}
+
+TorchTensor * torch_tensor_task_finish (GAsyncResult  *result,
+                                        gpointer       source_object,
+                                        gpointer       source_tag,
+                                        GError       **error);
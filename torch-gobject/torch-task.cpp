@@ -0,0 +1,149 @@
+/*
+ * torch-gobject/torch-task.cpp
+ *
+ * Run GTasks on the torch-gobject worker threads.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <ATen/ThreadLocalState.h>
+
+#include <gio/gio.h>
+
+#include <torch-gobject/torch-runtime-internal.h>
+#include <torch-gobject/torch-task-internal.h>
+#include <torch-gobject/torch-tensor-internal.h>
+
+namespace
+{
+  struct WorkerJob
+  {
+    GTask           *task;
+    GTaskThreadFunc  task_func;
+  };
+
+  void
+  run_worker_job (gpointer data, gpointer user_data)
+  {
+    WorkerJob *job = static_cast <WorkerJob *> (data);
+
+    torch_runtime_apply_cpu_affinity_to_current_thread ();
+
+    if (!g_task_return_error_if_cancelled (job->task))
+      job->task_func (job->task,
+                      g_task_get_source_object (job->task),
+                      g_task_get_task_data (job->task),
+                      g_task_get_cancellable (job->task));
+
+    g_object_unref (job->task);
+    g_free (job);
+  }
+
+  GThreadPool *
+  get_worker_pool (void)
+  {
+    static gsize        initialized = 0;
+    static GThreadPool *pool = NULL;
+
+    if (g_once_init_enter (&initialized))
+      {
+        /* Not exclusive, so that idle threads can be shared with
+         * other non-exclusive pools, but it is bounded separately
+         * from the GTask pool */
+        pool = g_thread_pool_new (run_worker_job,
+                                  NULL,
+                                  g_get_num_processors (),
+                                  FALSE,
+                                  NULL);
+        g_once_init_leave (&initialized, 1);
+      }
+
+    return pool;
+  }
+
+  void
+  run_real_tensor_task (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+  {
+    auto &func = *static_cast <std::function <at::Tensor ()> *> (task_data);
+
+    try
+      {
+        g_task_return_pointer (task,
+                               torch_tensor_new_from_real_tensor (func ()),
+                               g_object_unref);
+      }
+    catch (std::exception const &e)
+      {
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED, "%s", e.what ());
+      }
+  }
+}
+
+void
+torch_task_run_in_worker_thread (GTask           *task,
+                                 GTaskThreadFunc  task_func)
+{
+  WorkerJob *job = g_new0 (WorkerJob, 1);
+
+  job->task = static_cast <GTask *> (g_object_ref (task));
+  job->task_func = task_func;
+
+  g_thread_pool_push (get_worker_pool (), job, NULL);
+}
+
+void
+torch_tensor_run_real_task_in_worker_thread (gpointer                          source_object,
+                                             GCancellable                     *cancellable,
+                                             GAsyncReadyCallback               callback,
+                                             gpointer                          user_data,
+                                             gpointer                          source_tag,
+                                             std::function <at::Tensor ()>  &&func)
+{
+  g_autoptr (GTask) task = g_task_new (source_object, cancellable, callback, user_data);
+
+  g_task_set_source_tag (task, source_tag);
+  /* Run with the grad and inference mode of the calling thread,
+   * the same way that at::launch does */
+  std::function <at::Tensor ()> func_with_state = [func = std::move (func),
+                                                   state = at::ThreadLocalState ()]() -> at::Tensor {
+    at::ThreadLocalStateGuard guard (state);
+    return func ();
+  };
+
+  g_task_set_task_data (task,
+                        new std::function <at::Tensor ()> (std::move (func_with_state)),
+                        [](gpointer data) {
+                          delete static_cast <std::function <at::Tensor ()> *> (data);
+                        });
+
+  torch_task_run_in_worker_thread (task, run_real_tensor_task);
+}
+
+TorchTensor *
+torch_tensor_task_finish (GAsyncResult  *result,
+                          gpointer       source_object,
+                          gpointer       source_tag,
+                          GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source_object), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == source_tag, NULL);
+
+  return static_cast <TorchTensor *> (g_task_propagate_pointer (G_TASK (result), error));
+}
@@ -0,0 +1,354 @@
+/*
+ * torch-gobject/torch-tensor-pool.cpp
+ *
+ * Pool of recycled tensors, keyed by their shape and data type.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with eos-companion-app-service.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <gio/gio.h>
+
+#include <torch-gobject/torch-device.h>
+#include <torch-gobject/torch-device-internal.h>
+#include <torch-gobject/torch-tensor.h>
+#include <torch-gobject/torch-tensor-internal.h>
+#include <torch-gobject/torch-tensor-pool.h>
+#include <torch-gobject/torch-util.h>
+
+struct _TorchTensorPool
+{
+  GObject parent_instance;
+};
+
+namespace {
+typedef std::pair <c10::ScalarType, std::vector <int64_t>> TensorPoolKey;
+}
+
+typedef struct _TorchTensorPoolPrivate
+{
+  GMutex                                                    mutex;
+  std::map <TensorPoolKey, std::vector <TorchTensor *>>    *free_lists;
+  c10::Device                                              *real_device;
+
+  TorchDevice                                              *device;
+  guint                                                     max_tensors_per_key;
+} TorchTensorPoolPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (TorchTensorPool, torch_tensor_pool, G_TYPE_OBJECT)
+#define TORCH_TENSOR_POOL_GET_PRIVATE(a) static_cast <TorchTensorPoolPrivate *> (torch_tensor_pool_get_instance_private ((a)))
+
+enum {
+  PROP_0,
+  PROP_DEVICE,
+  PROP_MAX_TENSORS_PER_KEY,
+  NPROPS
+};
+
+static GParamSpec *torch_tensor_pool_props [NPROPS] = { NULL, };
+
+/**
+ * torch_tensor_pool_acquire:
+ * @pool: A #TorchTensorPool
+ * @sizes: (element-type gint64): A #GArray with the size of each dimension.
+ * @dtype: A #GType describing the type of each element.
+ * @error: A #GError
+ *
+ * Get a contiguous tensor with the given @sizes and @dtype on the
+ * device of @pool. If a tensor of the same shape and data type was
+ * released back to @pool, it is reused, otherwise a new tensor is
+ * allocated.
+ *
+ * The contents of the returned tensor are undefined, so it is meant
+ * to be used as the destination of an operation, for instance one of
+ * the `_out` variants of the tensor functions.
+ *
+ * Returns: (transfer full): A #TorchTensor or %NULL with @error set
+ *                           on failure.
+ */
+TorchTensor *
+torch_tensor_pool_acquire (TorchTensorPool  *pool,
+                           GArray           *sizes,
+                           GType             dtype,
+                           GError          **error)
+{
+  g_return_val_if_fail (TORCH_IS_TENSOR_POOL (pool), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+
+  return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> TorchTensor * {
+    c10::ScalarType       scalar_type = torch_scalar_type_from_gtype (dtype);
+    std::vector <int64_t> sizes_vec = int_list_from_g_array <gint64> (sizes);
+
+    {
+      g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&priv->mutex);
+      auto it = priv->free_lists->find (TensorPoolKey (scalar_type, sizes_vec));
+
+      if (it != priv->free_lists->end () && !it->second.empty ())
+        {
+          TorchTensor *tensor = it->second.back ();
+          it->second.pop_back ();
+
+          return tensor;
+        }
+    }
+
+    return torch_tensor_new_from_real_tensor (
+      torch::empty (torch::IntArrayRef (sizes_vec),
+                    torch::TensorOptions ().dtype (scalar_type).device (*priv->real_device))
+    );
+  });
+}
+
+/**
+ * torch_tensor_pool_release:
+ * @pool: A #TorchTensorPool
+ * @tensor: (transfer none): A #TorchTensor to return to @pool
+ *
+ * Return @tensor to @pool, so that a later call to
+ * %torch_tensor_pool_acquire with the same shape and data type can
+ * reuse it. The caller must not use @tensor after releasing it,
+ * since its contents will be overwritten by the next user.
+ *
+ * Only tensors which solely own their memory can be recycled: tensors
+ * that are views of other tensors, share their storage with another
+ * tensor, are on another device or are not contiguous are left alone,
+ * as are tensors which require gradients, inference tensors and
+ * tensors which are already in @pool.
+ * No more than #TorchTensorPool:max-tensors-per-key tensors are kept
+ * for each shape and data type.
+ *
+ * Returns: %TRUE if @tensor was taken into @pool, %FALSE otherwise.
+ */
+gboolean
+torch_tensor_pool_release (TorchTensorPool *pool,
+                           TorchTensor     *tensor)
+{
+  g_return_val_if_fail (TORCH_IS_TENSOR_POOL (pool), FALSE);
+  g_return_val_if_fail (TORCH_IS_TENSOR (tensor), FALSE);
+
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+  g_autoptr (GError)      error = NULL;
+
+  if (!torch_tensor_init_internal (tensor, &error))
+    return FALSE;
+
+  torch::Tensor &real_tensor = torch_tensor_get_real_tensor (tensor);
+
+  /* Tensors that take part in autograd or were created in inference
+   * mode cannot be handed out again as plain tensors */
+  if (!real_tensor.defined () ||
+      real_tensor.requires_grad () ||
+      real_tensor.is_inference () ||
+      real_tensor.device () != *priv->real_device ||
+      !real_tensor.is_contiguous () ||
+      real_tensor.storage_offset () != 0 ||
+      real_tensor.storage ().use_count () != 1 ||
+      real_tensor.storage ().nbytes () != real_tensor.nbytes ())
+    return FALSE;
+
+  TensorPoolKey key (real_tensor.scalar_type (),
+                     std::vector <int64_t> (real_tensor.sizes ().begin (),
+                                            real_tensor.sizes ().end ()));
+
+  g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&priv->mutex);
+  std::vector <TorchTensor *> &free_list = (*priv->free_lists)[std::move (key)];
+
+  if (free_list.size () >= priv->max_tensors_per_key ||
+      std::find (free_list.begin (), free_list.end (), tensor) != free_list.end ())
+    return FALSE;
+
+  free_list.push_back (static_cast <TorchTensor *> (g_object_ref (tensor)));
+  return TRUE;
+}
+
+/**
+ * torch_tensor_pool_clear:
+ * @pool: A #TorchTensorPool
+ *
+ * Drop all the tensors that @pool is holding on to for reuse.
+ */
+void
+torch_tensor_pool_clear (TorchTensorPool *pool)
+{
+  g_return_if_fail (TORCH_IS_TENSOR_POOL (pool));
+
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+  std::map <TensorPoolKey, std::vector <TorchTensor *>> free_lists;
+
+  /* Unref outside of the lock, since finalizing a tensor can
+   * take an arbitrary amount of time */
+  {
+    g_autoptr (GMutexLocker) locker = g_mutex_locker_new (&priv->mutex);
+    std::swap (free_lists, *priv->free_lists);
+  }
+
+  for (auto &entry : free_lists)
+    for (TorchTensor *tensor : entry.second)
+      g_object_unref (tensor);
+}
+
+static void
+torch_tensor_pool_init (TorchTensorPool *pool)
+{
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+
+  g_mutex_init (&priv->mutex);
+  priv->free_lists = new std::map <TensorPoolKey, std::vector <TorchTensor *>> ();
+}
+
+static void
+torch_tensor_pool_constructed (GObject *object)
+{
+  TorchTensorPool *pool = TORCH_TENSOR_POOL (object);
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+
+  priv->real_device = priv->device != NULL ?
+                      new c10::Device (torch_device_get_real_device (priv->device)) :
+                      new c10::Device (c10::DeviceType::CPU);
+
+  G_OBJECT_CLASS (torch_tensor_pool_parent_class)->constructed (object);
+}
+
+static void
+torch_tensor_pool_get_property (GObject      *object,
+                                unsigned int  prop_id,
+                                GValue       *value,
+                                GParamSpec   *pspec)
+{
+  TorchTensorPool *pool = TORCH_TENSOR_POOL (object);
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+
+  switch (prop_id)
+    {
+      case PROP_DEVICE:
+        g_value_set_object (value, priv->device);
+        break;
+      case PROP_MAX_TENSORS_PER_KEY:
+        g_value_set_uint (value, priv->max_tensors_per_key);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_tensor_pool_set_property (GObject      *object,
+                                unsigned int  prop_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+  TorchTensorPool *pool = TORCH_TENSOR_POOL (object);
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+
+  /* Properties only get set on construction */
+  switch (prop_id)
+    {
+      case PROP_DEVICE:
+        priv->device = static_cast <TorchDevice *> (g_value_dup_object (value));
+        break;
+      case PROP_MAX_TENSORS_PER_KEY:
+        priv->max_tensors_per_key = g_value_get_uint (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+torch_tensor_pool_dispose (GObject *object)
+{
+  TorchTensorPool *pool = TORCH_TENSOR_POOL (object);
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+
+  torch_tensor_pool_clear (pool);
+  g_clear_object (&priv->device);
+
+  G_OBJECT_CLASS (torch_tensor_pool_parent_class)->dispose (object);
+}
+
+static void
+torch_tensor_pool_finalize (GObject *object)
+{
+  TorchTensorPool *pool = TORCH_TENSOR_POOL (object);
+  TorchTensorPoolPrivate *priv = TORCH_TENSOR_POOL_GET_PRIVATE (pool);
+
+  delete priv->free_lists;
+  delete priv->real_device;
+  g_mutex_clear (&priv->mutex);
+
+  G_OBJECT_CLASS (torch_tensor_pool_parent_class)->finalize (object);
+}
+
+static void
+torch_tensor_pool_class_init (TorchTensorPoolClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = torch_tensor_pool_constructed;
+  object_class->get_property = torch_tensor_pool_get_property;
+  object_class->set_property = torch_tensor_pool_set_property;
+  object_class->dispose = torch_tensor_pool_dispose;
+  object_class->finalize = torch_tensor_pool_finalize;
+
+  torch_tensor_pool_props[PROP_DEVICE] =
+    g_param_spec_object ("device",
+                         "Device",
+                         "TorchDevice that tensors in the pool are allocated on, or NULL for the CPU",
+                         TORCH_TYPE_DEVICE,
+                         static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  torch_tensor_pool_props[PROP_MAX_TENSORS_PER_KEY] =
+    g_param_spec_uint ("max-tensors-per-key",
+                       "Max Tensors Per Key",
+                       "Maximum number of tensors kept for reuse for each shape and data type",
+                       0,
+                       G_MAXUINT,
+                       16,
+                       static_cast <GParamFlags> (G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_properties (object_class,
+                                     NPROPS,
+                                     torch_tensor_pool_props);
+}
+
+/**
+ * torch_tensor_pool_new:
+ * @device: (nullable): The #TorchDevice to allocate tensors on, or %NULL
+ *          for the CPU.
+ *
+ * Create a new #TorchTensorPool, which hands out recycled tensors
+ * with a given shape and data type, so that loops which produce
+ * same-shaped outputs over and over do not need to allocate new
+ * tensors every time.
+ *
+ * Returns: (transfer full): A new #TorchTensorPool
+ */
+TorchTensorPool *
+torch_tensor_pool_new (TorchDevice *device)
+{
+  return static_cast <TorchTensorPool *> (g_object_new (TORCH_TYPE_TENSOR_POOL,
+                                                        "device", device,
+                                                        NULL));
+}
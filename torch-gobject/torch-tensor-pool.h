@@ -0,0 +1,47 @@
+/*
+ * torch-gobject/torch-tensor-pool.h
+ *
+ * Pool of recycled tensors, keyed by their shape and data type.
+ *
+ * Copyright (C) 2020 Sam Spilsbury.
+ *
+ * torch-gobject is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * torch-gobject is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along
+ * with torch-gobject; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include <torch-gobject/torch-device.h>
+#include <torch-gobject/torch-tensor.h>
+
+G_BEGIN_DECLS
+
+#define TORCH_TYPE_TENSOR_POOL torch_tensor_pool_get_type ()
+G_DECLARE_FINAL_TYPE (TorchTensorPool, torch_tensor_pool, TORCH, TENSOR_POOL, GObject)
+
+TorchTensorPool * torch_tensor_pool_new (TorchDevice *device);
+
+TorchTensor * torch_tensor_pool_acquire (TorchTensorPool  *pool,
+                                         GArray           *sizes,
+                                         GType             dtype,
+                                         GError          **error);
+
+gboolean torch_tensor_pool_release (TorchTensorPool *pool,
+                                    TorchTensor     *tensor);
+
+void torch_tensor_pool_clear (TorchTensorPool *pool);
+
+G_END_DECLS
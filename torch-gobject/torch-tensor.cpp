@@ -20,6 +20,8 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <new>
 #include <stdexcept>
 #include <vector>
 
@@ -30,6 +32,9 @@
 #include <torch-gobject/torch-device.h>
 #include <torch-gobject/torch-device-internal.h>
 #include <torch-gobject/torch-errors.h>
+#include <torch-gobject/torch-storage.h>
+#include <torch-gobject/torch-storage-internal.h>
+#include <torch-gobject/torch-task-internal.h>
 #include <torch-gobject/torch-tensor.h>
 #include <torch-gobject/torch-tensor-index.h>
 #include <torch-gobject/torch-tensor-index-array.h>
@@ -44,11 +49,16 @@ struct _TorchTensor
 
 typedef struct _TorchTensorPrivate
 {
-  torch::Tensor *internal;
-
+  /* Stored by value, constructed in torch_tensor_init and destroyed
+   * in torch_tensor_finalize. It is an undefined tensor until
+   * has_internal is set. */
+  torch::Tensor internal;
+  gboolean      has_internal;
+
+  /* Set through the properties before the tensor is first used,
+   * consumed by torch_tensor_initable_init */
   GVariant    *construction_data;
   GList       *construction_dims;
-  gboolean     is_constructed;
 } TorchTensorPrivate;
 
 static void initable_iface_init (GInitableIface *iface);
@@ -76,25 +86,6 @@ namespace
     delete t;
   }
 
-  /* XXX: Its not entirely clear to me why,
-   *      but if we return an IntArrayRef here, we crash
-   *      because at::List doesn't make a copy of the underlying
-   *      memory, and the constructor does not take an rvalue
-   *      reference, so the move never happens. */
-  template <typename Source>
-  std::vector<int64_t> int_list_from_g_array (GArray *array)
-  {
-    std::vector <int64_t> vec;
-    size_t n_elements = array != NULL ? array->len : 0;
-    const Source *array_data = array != NULL ? reinterpret_cast <Source *> (array->data) : NULL;
-    vec.reserve (n_elements);
-
-    for (size_t i = 0; i < n_elements; ++i)
-      vec.push_back (array_data[i]);
-
-    return vec;
-  }
-
   template <typename Target>
   GArray * g_array_from_int_list (torch::IntArrayRef const &list)
   {
@@ -154,11 +145,20 @@ namespace
     return static_cast <GList *> (g_steal_pointer (&list));
   }
 
-  class InvalidVariantTypeError : public std::logic_error
+  class InvalidDataTypeError : public std::logic_error
+  {
+    public:
+      InvalidDataTypeError (std::string const &message) :
+        std::logic_error::logic_error (message)
+      {
+      }
+  };
+
+  class InvalidVariantTypeError : public InvalidDataTypeError
   {
     public:
       InvalidVariantTypeError (GVariantType const *variant_type) :
-        std::logic_error::logic_error (InvalidVariantTypeError::format_error (variant_type))
+        InvalidDataTypeError (InvalidVariantTypeError::format_error (variant_type))
       {
       }
 
@@ -173,11 +173,11 @@ namespace
       }
   };
 
-  class InvalidScalarTypeError : public std::logic_error
+  class InvalidScalarTypeError : public InvalidDataTypeError
   {
     public:
       InvalidScalarTypeError (c10::ScalarType const &scalar_type) :
-        std::logic_error::logic_error (InvalidScalarTypeError::format_error (scalar_type))
+        InvalidDataTypeError (InvalidScalarTypeError::format_error (scalar_type))
       {
       }
 
@@ -190,47 +190,139 @@ namespace
       }
   };
 
+  class InvalidShapeError : public std::logic_error
+  {
+    public:
+      InvalidShapeError (std::string const &message) :
+        std::logic_error::logic_error (message)
+      {
+      }
+  };
+
+  std::vector <int64_t> contiguous_strides_for_sizes (std::vector <int64_t> const &sizes)
+  {
+    std::vector <int64_t> strides (sizes.size ());
+    int64_t               stride = 1;
+
+    for (size_t i = sizes.size (); i > 0; --i)
+      {
+        strides[i - 1] = stride;
+        stride *= std::max <int64_t> (sizes[i - 1], 1);
+      }
+
+    return strides;
+  }
+
+  /* Number of bytes that a tensor with the given layout spans in
+   * its underlying storage, starting from its first element. */
+  size_t storage_bytes_for_layout (std::vector <int64_t> const &sizes,
+                                   std::vector <int64_t> const &strides,
+                                   size_t                       element_size)
+  {
+    int64_t max_offset = 0;
+
+    if (sizes.size () != strides.size ())
+      throw InvalidShapeError ("Number of strides does not match number of dimensions");
+
+    for (size_t i = 0; i < sizes.size (); ++i)
+      {
+        if (sizes[i] < 0 || strides[i] < 0)
+          throw InvalidShapeError ("Sizes and strides must not be negative");
+
+        /* Tensors with no elements do not need any storage */
+        if (sizes[i] == 0)
+          return 0;
+
+        max_offset += (sizes[i] - 1) * strides[i];
+      }
+
+    return (max_offset + 1) * element_size;
+  }
+
+  /* Every data type that can be serialized, along with the name used
+   * to tag it in serialized data and the GVariant basic type that
+   * holds it natively, if there is one. Data types without a native
+   * GVariant type (for instance float32 and float16) are serialized
+   * as raw bytes in native byte order. */
+  struct ScalarTypeInfo
+  {
+    c10::ScalarType  scalar_type;
+    const char      *name;
+    const char      *variant_type_string;
+  };
+
+  const ScalarTypeInfo scalar_type_infos[] = {
+    { torch::kBool, "bool", "b" },
+    { torch::kUInt8, "uint8", "y" },
+    { torch::kInt8, "int8", NULL },
+    { torch::kInt16, "int16", "n" },
+    { torch::kInt32, "int32", "i" },
+    { torch::kInt64, "int64", "x" },
+    { torch::kFloat16, "float16", NULL },
+    { torch::kBFloat16, "bfloat16", NULL },
+    { torch::kFloat32, "float32", NULL },
+    { torch::kFloat64, "float64", "d" }
+  };
+
+  ScalarTypeInfo const & scalar_type_info (c10::ScalarType scalar_type)
+  {
+    for (auto const &entry : scalar_type_infos)
+      if (entry.scalar_type == scalar_type)
+        return entry;
+
+    throw InvalidScalarTypeError (scalar_type);
+  }
+
+  const char * scalar_type_to_name (c10::ScalarType scalar_type)
+  {
+    return scalar_type_info (scalar_type).name;
+  }
+
+  c10::ScalarType scalar_type_from_name (const char *name)
+  {
+    for (auto const &entry : scalar_type_infos)
+      if (g_str_equal (entry.name, name))
+        return entry.scalar_type;
+
+    throw InvalidDataTypeError (std::string ("Unknown data type name ") + name);
+  }
+
+  /* Returns the GVariant basic type which stores elements of
+   * @scalar_type natively, or %NULL if they must be stored as
+   * raw bytes. */
   GVariantType const * scalar_type_to_g_variant_type (c10::ScalarType scalar_type)
   {
-    /* XXX: We do not support float tensors
-     *      at the moment as GVariant doesn't
-     *      support floats. */
-    if (scalar_type == torch::kFloat64) {
-      return G_VARIANT_TYPE_DOUBLE;
-    } else if (scalar_type == torch::kFloat) {
-      return G_VARIANT_TYPE_DOUBLE;
-    }else if (scalar_type == torch::kInt64) {
-      return G_VARIANT_TYPE_INT64;
-    } else {
-      throw InvalidScalarTypeError (scalar_type);
-    }
+    const char *variant_type_string = scalar_type_info (scalar_type).variant_type_string;
+
+    return variant_type_string != NULL ? G_VARIANT_TYPE (variant_type_string) : NULL;
   }
 
   c10::ScalarType g_variant_type_to_scalar_type (const GVariantType *variant_type)
   {
-    /* XXX: We do not support float tensors
-     *      at the moment as GVariant doesn't
-     *      support floats. */
-    if (g_variant_type_equal (variant_type, G_VARIANT_TYPE_DOUBLE)) {
-      return torch::kFloat64;
-    } else if (g_variant_type_equal (variant_type, G_VARIANT_TYPE_INT64)) {
-      return torch::kInt64;
-    } else {
-      throw InvalidVariantTypeError (variant_type);
-    }
+    for (auto const &entry : scalar_type_infos)
+      if (entry.variant_type_string != NULL &&
+          g_variant_type_equal (variant_type, G_VARIANT_TYPE (entry.variant_type_string)))
+        return entry.scalar_type;
+
+    throw InvalidVariantTypeError (variant_type);
   }
 
-  size_t scalar_type_to_element_size (c10::ScalarType scalar_type)
+  /* The flat serialization stores elements natively where GVariant has
+   * an equivalent type, and as raw bytes tagged by the dtype name
+   * otherwise. */
+  GVariantType const * scalar_type_to_flat_g_variant_element_type (c10::ScalarType scalar_type)
   {
-    if (scalar_type == torch::kFloat64) {
-      return sizeof (double);
-    } else if (scalar_type == torch::kFloat) {
-      return sizeof (double);
-    } else if (scalar_type == torch::kInt64) {
-      return sizeof (int64_t);
-    } else {
-      throw InvalidScalarTypeError (scalar_type);
-    }
+    GVariantType const *variant_type = scalar_type_to_g_variant_type (scalar_type);
+
+    return variant_type != NULL ? variant_type : G_VARIANT_TYPE_BYTE;
+  }
+
+  size_t flat_g_variant_element_size (c10::ScalarType scalar_type)
+  {
+    if (scalar_type_to_g_variant_type (scalar_type) == NULL)
+      return 1;
+
+    return c10::elementSize (scalar_type);
   }
 
   template <typename T>
@@ -242,95 +334,174 @@ namespace
     return vec_out;
   }
 
-  std::tuple <GVariantType const *, std::vector <int64_t>> ascertain_underlying_type_and_dimensions (GVariant *array_variant)
+  /* Leaf arrays in the nested serialization are either a fixed array
+   * of a GVariant basic type or, for data types that GVariant cannot
+   * represent natively, a "(say)" tuple of the data type name and
+   * the raw bytes of the elements. */
+  gboolean is_tagged_leaf_variant (GVariant *leaf_variant)
+  {
+    return g_variant_is_of_type (leaf_variant, G_VARIANT_TYPE ("(say)"));
+  }
+
+  c10::ScalarType leaf_variant_scalar_type (GVariant *leaf_variant)
   {
-    GVariantType const *array_variant_type = G_VARIANT_TYPE (g_variant_get_type_string (array_variant));
-    if (!g_variant_type_equal (array_variant_type, G_VARIANT_TYPE ("av")))
+    GVariantType const *leaf_type = g_variant_get_type (leaf_variant);
+
+    if (is_tagged_leaf_variant (leaf_variant))
       {
-        g_assert (g_variant_type_is_container (array_variant_type));
-        return std::make_tuple (array_variant_type,
+        const char *dtype_name = NULL;
+
+        g_variant_get_child (leaf_variant, 0, "&s", &dtype_name);
+        return scalar_type_from_name (dtype_name);
+      }
+
+    if (!g_variant_type_is_array (leaf_type))
+      throw InvalidVariantTypeError (leaf_type);
+
+    return g_variant_type_to_scalar_type (g_variant_type_element (leaf_type));
+  }
+
+  /* Returns the elements of a leaf array and stores the number of
+   * elements in @out_n_elements. The returned pointer is owned by
+   * @leaf_variant. */
+  gconstpointer leaf_variant_get_elements (GVariant        *leaf_variant,
+                                           c10::ScalarType  scalar_type,
+                                           size_t          *out_n_elements)
+  {
+    const size_t element_size = c10::elementSize (scalar_type);
+    gsize        n_bytes_or_elements = 0;
+
+    if (!is_tagged_leaf_variant (leaf_variant))
+      {
+        gconstpointer elements = g_variant_get_fixed_array (leaf_variant,
+                                                            &n_bytes_or_elements,
+                                                            element_size);
+        *out_n_elements = n_bytes_or_elements;
+        return elements;
+      }
+
+    /* The child shares its serialized data with the leaf, so the
+     * pointer stays valid after the child is released. */
+    g_autoptr(GVariant) bytes_variant = g_variant_get_child_value (leaf_variant, 1);
+    gconstpointer       bytes = g_variant_get_fixed_array (bytes_variant, &n_bytes_or_elements, 1);
+
+    if (n_bytes_or_elements % element_size != 0)
+      throw InvalidShapeError ("Size of the data is not a multiple of the element size");
+
+    *out_n_elements = n_bytes_or_elements / element_size;
+    return bytes;
+  }
+
+  size_t leaf_variant_n_elements (GVariant *leaf_variant, c10::ScalarType scalar_type)
+  {
+    size_t n_elements = 0;
+
+    leaf_variant_get_elements (leaf_variant, scalar_type, &n_elements);
+    return n_elements;
+  }
+
+  std::tuple <c10::ScalarType, std::vector <int64_t>> ascertain_underlying_type_and_dimensions (GVariant *array_variant)
+  {
+    if (!g_variant_is_of_type (array_variant, G_VARIANT_TYPE ("av")))
+      {
+        c10::ScalarType scalar_type = leaf_variant_scalar_type (array_variant);
+
+        return std::make_tuple (scalar_type,
                                 append_to_vector (std::vector <int64_t> (),
-                                                  static_cast <int64_t> (g_variant_n_children (array_variant))));
+                                                  static_cast <int64_t> (leaf_variant_n_elements (array_variant,
+                                                                                                  scalar_type))));
       }
 
+    if (g_variant_n_children (array_variant) == 0)
+      throw InvalidShapeError ("Cannot determine the data type of an empty array of variants");
+
     g_autoptr(GVariant) child_variant = g_variant_ref_sink (g_variant_get_child_value (array_variant, 0));
     g_autoptr(GVariant) child_array = g_variant_ref_sink (g_variant_get_variant (child_variant));
 
-    GVariantType const *variant_type;
+    c10::ScalarType scalar_type;
     std::vector <int64_t> dimension_vec;
 
-    std::tie (variant_type, dimension_vec) = ascertain_underlying_type_and_dimensions (child_array);
+    std::tie (scalar_type, dimension_vec) = ascertain_underlying_type_and_dimensions (child_array);
 
-    return std::make_tuple (variant_type,
+    return std::make_tuple (scalar_type,
                             append_to_vector (std::move (dimension_vec),
                                               static_cast <int64_t> (g_variant_n_children (array_variant))));
   }
 
-  template <typename T>
-  void iterate_and_assign_to_tensor (torch::Tensor &tensor,
-                                     const char    *type_string,
-                                     GVariant      *array_variant)
+  /* Check that every sub-array along a given dimension has the same
+   * number of children and the same underlying type, so that the
+   * nested arrays can be copied into a rectangular tensor. */
+  void check_nested_variant_arrays_are_rectangular (GVariant                    *array_variant,
+                                                    c10::ScalarType              scalar_type,
+                                                    std::vector <int64_t> const &dimensions,
+                                                    size_t                       depth)
   {
-    T scalar;
-    GVariantIter iter;
-    size_t       count = 0;
+    const gboolean is_leaf = !g_variant_is_of_type (array_variant, G_VARIANT_TYPE ("av"));
+
+    if (is_leaf != (depth + 1 == dimensions.size ()))
+      throw InvalidShapeError ("Nested arrays do not all have the same depth");
+
+    if (is_leaf)
+      {
+        if (leaf_variant_scalar_type (array_variant) != scalar_type)
+          throw InvalidVariantTypeError (g_variant_get_type (array_variant));
+
+        if (static_cast <int64_t> (leaf_variant_n_elements (array_variant, scalar_type)) != dimensions[depth])
+          throw InvalidShapeError ("Nested arrays along the same dimension do not all have the same size");
+
+        return;
+      }
 
-    g_variant_iter_init (&iter, array_variant);
+    if (static_cast <int64_t> (g_variant_n_children (array_variant)) != dimensions[depth])
+      throw InvalidShapeError ("Nested arrays along the same dimension do not all have the same size");
 
-    while (g_variant_iter_next (&iter, type_string, &scalar))
+    for (size_t i = 0; i < static_cast <size_t> (dimensions[depth]); ++i)
       {
-        tensor[count++] = scalar;
+        g_autoptr(GVariant) child_variant = g_variant_get_child_value (array_variant, i);
+        g_autoptr(GVariant) child_array = g_variant_get_variant (child_variant);
+
+        check_nested_variant_arrays_are_rectangular (child_array, scalar_type, dimensions, depth + 1);
       }
   }
 
-  void set_tensor_data_from_nested_variant_arrays (torch::Tensor       &tensor,
-                                                   GVariant            *array_variant,
-                                                   GVariantType  const *underlying_type)
+  /* Copy the leaf arrays of the nested array-of-variants structure
+   * into the contiguous buffer, one memcpy per leaf array. Returns
+   * the number of bytes written. */
+  size_t copy_nested_variant_arrays_to_buffer (GVariant        *array_variant,
+                                               c10::ScalarType  scalar_type,
+                                               char            *buffer)
   {
     /* Base case */
     if (!g_variant_is_of_type (array_variant, G_VARIANT_TYPE ("av")))
       {
-        g_assert (g_variant_type_is_container (G_VARIANT_TYPE (g_variant_get_type_string (array_variant))));
-        g_assert (g_variant_is_of_type (array_variant, underlying_type));
+        const size_t  element_size = c10::elementSize (scalar_type);
+        size_t        n_elements = 0;
+        gconstpointer elements = leaf_variant_get_elements (array_variant, scalar_type, &n_elements);
 
-        const char   *type_string = (g_variant_type_peek_string (underlying_type) + 1);
+        if (n_elements > 0)
+          memcpy (buffer, elements, n_elements * element_size);
 
-        if (g_variant_type_equal (underlying_type, G_VARIANT_TYPE ("ad")))
-          {
-            iterate_and_assign_to_tensor <double> (tensor, type_string, array_variant);
-          }
-        else if (g_variant_type_equal (underlying_type, G_VARIANT_TYPE ("ax")))
-          {
-            iterate_and_assign_to_tensor <int64_t> (tensor, type_string, array_variant);
-          }
-        else
-          {
-            throw InvalidVariantTypeError (underlying_type);
-          }
-
-        return;
+        return n_elements * element_size;
       }
 
     /* Recursive case */
-    GVariantIter iter;
-    GVariant     *unowned_child_array;
-    size_t       tensor_index = 0;
+    const size_t n_children = g_variant_n_children (array_variant);
+    size_t       offset = 0;
 
-    g_variant_iter_init (&iter, array_variant);
-    while (g_variant_iter_next (&iter, "v", &unowned_child_array))
+    for (size_t i = 0; i < n_children; ++i)
       {
-        g_autoptr(GVariant) child_array = g_variant_ref_sink (unowned_child_array);
-
-        torch::Tensor child_tensor (tensor[tensor_index]);
-        set_tensor_data_from_nested_variant_arrays (child_tensor, child_array, underlying_type);
+        g_autoptr(GVariant) child_variant = g_variant_get_child_value (array_variant, i);
+        g_autoptr(GVariant) child_array = g_variant_get_variant (child_variant);
 
-        ++tensor_index;
+        offset += copy_nested_variant_arrays_to_buffer (child_array, scalar_type, buffer + offset);
       }
+
+    return offset;
   }
 
   torch::Tensor new_tensor_from_nested_gvariants (GVariant *array_variant)
   {
-    GVariantType const *variant_type = G_VARIANT_TYPE (g_variant_get_type_string (array_variant));
+    GVariantType const *variant_type = g_variant_get_type (array_variant);
 
     /* Handle some non-array cases first */
     if (g_variant_type_equal (variant_type, G_VARIANT_TYPE ("v")))
@@ -338,95 +509,353 @@ namespace
         g_autoptr (GVariant) v = g_variant_ref_sink (g_variant_get_variant (array_variant));
         return new_tensor_from_nested_gvariants (v);
       }
-    else if (g_variant_type_equal (variant_type, G_VARIANT_TYPE ("d")))
-      {
-        double v = g_variant_get_double (array_variant);
-        return torch::tensor(v, torch::kFloat64);
-      }
-    else if (g_variant_type_equal (variant_type, G_VARIANT_TYPE ("x")))
+    else if (g_variant_type_is_basic (variant_type))
       {
-        int64_t v = g_variant_get_double (array_variant);
-        return torch::tensor(v, torch::kInt64);
+        /* Single values of fixed-size basic types are serialized
+         * exactly as the element itself would be in memory */
+        c10::ScalarType scalar_type = g_variant_type_to_scalar_type (variant_type);
+        torch::Tensor tensor = torch::empty (
+          {},
+          torch::TensorOptions ().dtype (scalar_type).device (torch::kCPU)
+        );
+
+        memcpy (tensor.data_ptr (), g_variant_get_data (array_variant), c10::elementSize (scalar_type));
+        return tensor;
       }
 
-    GVariantType const *underlying_type;
+    c10::ScalarType scalar_type;
     std::vector <int64_t> dimensions;
 
-    std::tie (underlying_type, dimensions) = ascertain_underlying_type_and_dimensions (array_variant);
+    std::tie (scalar_type, dimensions) = ascertain_underlying_type_and_dimensions (array_variant);
     std::reverse (dimensions.begin (), dimensions.end ());
 
-    torch::Tensor tensor = torch::zeros (
+    /* Validate the whole structure before allocating anything, so that
+     * the copy below can write each leaf array straight into place. */
+    check_nested_variant_arrays_are_rectangular (array_variant, scalar_type, dimensions, 0);
+
+    torch::Tensor tensor = torch::empty (
       torch::IntArrayRef (dimensions),
-      g_variant_type_to_scalar_type (g_variant_type_element (underlying_type))
-    ).cpu ();
-    set_tensor_data_from_nested_variant_arrays (tensor, array_variant, underlying_type);
+      torch::TensorOptions ().dtype (scalar_type).device (torch::kCPU)
+    );
+    copy_nested_variant_arrays_to_buffer (array_variant,
+                                          scalar_type,
+                                          static_cast <char *> (tensor.data_ptr ()));
 
     return tensor;
   }
 
-  GVariant * serialize_tensor_data_to_nested_gvariants (torch::Tensor const &tensor)
+  /* Merge adjacent dimensions which are laid out contiguously with
+   * respect to each other and drop dimensions of size one, so that
+   * the gather loop below runs over as few, long rows as possible. A
+   * contiguous tensor collapses into a single row. */
+  void coalesce_dimensions (torch::IntArrayRef const &tensor_sizes,
+                            torch::IntArrayRef const &tensor_strides,
+                            std::vector <int64_t>    &sizes,
+                            std::vector <int64_t>    &strides)
   {
-    /* Special case for single values, only one value to serialize */
-    if (tensor.dim () == 0)
+    sizes.reserve (tensor_sizes.size ());
+    strides.reserve (tensor_strides.size ());
+
+    for (size_t i = 0; i < tensor_sizes.size (); ++i)
       {
-        auto scalar_type = tensor.scalar_type ();
+        if (tensor_sizes[i] == 1)
+          continue;
 
-        if (scalar_type == torch::kFloat64)
-          return g_variant_new_double (tensor.item ().to <double> ());
+        if (!sizes.empty () && strides.back () == tensor_sizes[i] * tensor_strides[i])
+          {
+            sizes.back () *= tensor_sizes[i];
+            strides.back () = tensor_strides[i];
+            continue;
+          }
 
-        if (scalar_type == torch::kFloat)
-          return g_variant_new_double (tensor.item ().to <double> ());
+        sizes.push_back (tensor_sizes[i]);
+        strides.push_back (tensor_strides[i]);
+      }
+  }
 
-        if (scalar_type == torch::kInt64)
-          return g_variant_new_int64 (tensor.item ().to <int64_t> ());
+  /* Copy elements in row-major order from @src, laid out according to
+   * @sizes and @strides (in elements), into the contiguous @dst. The
+   * outer dimensions are walked with an odometer over the strides and
+   * the innermost dimension is either a single memcpy or a simple
+   * strided loop that the compiler can vectorize. */
+  template <typename Element>
+  void gather_strided_elements (Element const               *src,
+                                Element                     *dst,
+                                std::vector <int64_t> const &sizes,
+                                std::vector <int64_t> const &strides)
+  {
+    const size_t n_dims = sizes.size ();
 
-        throw InvalidScalarTypeError (scalar_type);
+    if (n_dims == 0)
+      {
+        *dst = *src;
+        return;
       }
 
-    /* Base case for arrays, only a single dimension left */
-    if (tensor.dim () == 1)
+    const int64_t         inner_size = sizes[n_dims - 1];
+    const int64_t         inner_stride = strides[n_dims - 1];
+    std::vector <int64_t> index (n_dims - 1, 0);
+
+    for (;;)
       {
-        size_t sz = tensor.sizes ()[0];
-        if (tensor.scalar_type () == torch::kFloat)
+        if (inner_stride == 1)
           {
-            /* Different logic, we need to convert the array of floats
-             * into an array of doubles first */
-            std::vector <double> data (sz);
-            const float *tensor_data = static_cast <float *> (tensor.data_ptr ()); 
+            memcpy (dst, src, inner_size * sizeof (Element));
+          }
+        else
+          {
+            for (int64_t j = 0; j < inner_size; ++j)
+              dst[j] = src[j * inner_stride];
+          }
 
-            for (size_t i = 0; i < sz; ++i)
-              {
-                data[i] = tensor_data[i];
-              }
+        dst += inner_size;
 
-            return g_variant_new_fixed_array (scalar_type_to_g_variant_type (tensor.scalar_type ()),
-                                              tensor_data,
-                                              sz,
-                                              sizeof (double));
+        /* Advance to the start of the next row */
+        size_t d = n_dims - 1;
+
+        for (;;)
+          {
+            if (d == 0)
+              return;
+
+            --d;
+            src += strides[d];
+
+            if (++index[d] < sizes[d])
+              break;
+
+            src -= strides[d] * sizes[d];
+            index[d] = 0;
           }
+      }
+  }
+
+  /* Copy the elements of a CPU tensor into @buffer in row-major order,
+   * walking its sizes and strides directly so that transposed and
+   * sliced views do not need to be made contiguous first. @buffer must
+   * be at least tensor.nbytes () long. */
+  void gather_tensor_elements (torch::Tensor const &tensor, void *buffer)
+  {
+    if (tensor.numel () == 0)
+      return;
+
+    std::vector <int64_t> sizes, strides;
+    coalesce_dimensions (tensor.sizes (), tensor.strides (), sizes, strides);
+
+    switch (tensor.element_size ())
+      {
+        case 1:
+          gather_strided_elements (static_cast <uint8_t const *> (tensor.data_ptr ()),
+                                   static_cast <uint8_t *> (buffer),
+                                   sizes,
+                                   strides);
+          break;
+        case 2:
+          gather_strided_elements (static_cast <uint16_t const *> (tensor.data_ptr ()),
+                                   static_cast <uint16_t *> (buffer),
+                                   sizes,
+                                   strides);
+          break;
+        case 4:
+          gather_strided_elements (static_cast <uint32_t const *> (tensor.data_ptr ()),
+                                   static_cast <uint32_t *> (buffer),
+                                   sizes,
+                                   strides);
+          break;
+        case 8:
+          gather_strided_elements (static_cast <uint64_t const *> (tensor.data_ptr ()),
+                                   static_cast <uint64_t *> (buffer),
+                                   sizes,
+                                   strides);
+          break;
+        default:
+          throw InvalidScalarTypeError (tensor.scalar_type ());
+      }
+  }
+
+  GVariant * serialize_tensor_data_to_flat_gvariant (torch::Tensor const &tensor)
+  {
+    torch::Tensor       cpu = tensor.cpu ();
+    c10::ScalarType     scalar_type = cpu.scalar_type ();
+    const size_t        n_bytes = cpu.nbytes ();
+    std::vector <guint64> shape (cpu.sizes ().begin (), cpu.sizes ().end ());
+
+    /* Gather straight into the memory that will back the variant */
+    g_autofree char *buffer = static_cast <char *> (g_malloc (n_bytes));
+    gather_tensor_elements (cpu, buffer);
+
+    g_autoptr(GBytes)       data_bytes = g_bytes_new_take (g_steal_pointer (&buffer), n_bytes);
+    g_autoptr(GVariantType) data_type = g_variant_type_new_array (scalar_type_to_flat_g_variant_element_type (scalar_type));
+
+    GVariant *children[] = {
+      g_variant_new_string (scalar_type_to_name (scalar_type)),
+      g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+                                 shape.data (),
+                                 shape.size (),
+                                 sizeof (guint64)),
+      g_variant_new_from_bytes (data_type, data_bytes, TRUE)
+    };
+
+    return g_variant_new_tuple (children, G_N_ELEMENTS (children));
+  }
 
-        return g_variant_new_fixed_array (scalar_type_to_g_variant_type (tensor.scalar_type ()),
-                                          tensor.data_ptr (),
-                                          sz,
-                                          scalar_type_to_element_size (tensor.scalar_type ()));
+  /* Build the nested array-of-variants structure for the dimensions
+   * starting at @depth from the row-major @elements. */
+  GVariant * serialize_elements_to_nested_gvariants (char const                *elements,
+                                                     torch::IntArrayRef const  &sizes,
+                                                     size_t                     depth,
+                                                     c10::ScalarType            scalar_type)
+  {
+    GVariantType const *variant_type = scalar_type_to_g_variant_type (scalar_type);
+    const size_t        element_size = c10::elementSize (scalar_type);
+    const size_t        size = sizes[depth];
+
+    /* Base case for arrays, only a single dimension left */
+    if (depth + 1 == sizes.size ())
+      {
+        if (variant_type != NULL)
+          return g_variant_new_fixed_array (variant_type,
+                                            elements,
+                                            size,
+                                            element_size);
+
+        GVariant *children[] = {
+          g_variant_new_string (scalar_type_to_name (scalar_type)),
+          g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                     elements,
+                                     size * element_size,
+                                     1)
+        };
+
+        return g_variant_new_tuple (children, G_N_ELEMENTS (children));
       }
 
     /* Recursive case: Build a new array-of-variants
      * by looping through the current dimension and
      * getting arrays from that. */
+    size_t row_size = element_size;
+
+    for (size_t i = depth + 1; i < sizes.size (); ++i)
+      row_size *= sizes[i];
+
     g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("av"));
     g_variant_builder_init (&builder, G_VARIANT_TYPE ("av"));
-    size_t size = tensor.sizes ()[0];
 
     for (size_t i = 0; i < size; ++i)
       {
         g_variant_builder_add (&builder,
                                "v",
-                               serialize_tensor_data_to_nested_gvariants (tensor[i]));
+                               serialize_elements_to_nested_gvariants (elements + i * row_size,
+                                                                       sizes,
+                                                                       depth + 1,
+                                                                       scalar_type));
       }
 
     return g_variant_builder_end (&builder);
   }
+
+  GVariant * serialize_tensor_data_to_nested_gvariants (torch::Tensor const &tensor)
+  {
+    torch::Tensor       cpu = tensor.cpu ();
+    c10::ScalarType     scalar_type = cpu.scalar_type ();
+    GVariantType const *variant_type = scalar_type_to_g_variant_type (scalar_type);
+    const size_t        element_size = c10::elementSize (scalar_type);
+
+    /* Special case for single values, only one value to serialize.
+     * Data types without a native GVariant type need their dtype
+     * tag, so they are serialized in the flat format instead. */
+    if (cpu.dim () == 0)
+      {
+        if (variant_type == NULL)
+          return serialize_tensor_data_to_flat_gvariant (cpu);
+
+        g_autoptr(GBytes) bytes = g_bytes_new (cpu.data_ptr (), element_size);
+
+        return g_variant_new_from_bytes (variant_type, bytes, TRUE);
+      }
+
+    /* Gather all the elements once, then slice the rows out of the
+     * gathered buffer, as opposed to creating a view per row. */
+    if (cpu.is_contiguous ())
+      return serialize_elements_to_nested_gvariants (static_cast <char const *> (cpu.data_ptr ()),
+                                                     cpu.sizes (),
+                                                     0,
+                                                     scalar_type);
+
+    g_autofree char *buffer = static_cast <char *> (g_malloc (cpu.nbytes ()));
+    gather_tensor_elements (cpu, buffer);
+
+    return serialize_elements_to_nested_gvariants (buffer, cpu.sizes (), 0, scalar_type);
+  }
+
+  gboolean is_flat_tensor_variant (GVariant *variant)
+  {
+    GVariantType const *variant_type = g_variant_get_type (variant);
+
+    if (!g_variant_type_is_tuple (variant_type) || g_variant_type_n_items (variant_type) != 3)
+      return FALSE;
+
+    GVariantType const *dtype_type = g_variant_type_first (variant_type);
+    GVariantType const *shape_type = g_variant_type_next (dtype_type);
+    GVariantType const *data_type = g_variant_type_next (shape_type);
+
+    return g_variant_type_equal (dtype_type, G_VARIANT_TYPE_STRING) &&
+           g_variant_type_equal (shape_type, G_VARIANT_TYPE ("at")) &&
+           g_variant_type_is_array (data_type) &&
+           g_variant_type_is_basic (g_variant_type_element (data_type));
+  }
+
+  torch::Tensor new_tensor_from_flat_gvariant (GVariant *flat_variant)
+  {
+    const char          *dtype_name = NULL;
+    g_autoptr(GVariant)  shape_variant = g_variant_get_child_value (flat_variant, 1);
+    g_autoptr(GVariant)  data_variant = g_variant_get_child_value (flat_variant, 2);
+
+    g_variant_get_child (flat_variant, 0, "&s", &dtype_name);
+
+    c10::ScalarType     scalar_type = scalar_type_from_name (dtype_name);
+    GVariantType const *element_type = scalar_type_to_flat_g_variant_element_type (scalar_type);
+
+    if (!g_variant_type_equal (g_variant_type_element (g_variant_get_type (data_variant)), element_type))
+      throw InvalidVariantTypeError (g_variant_get_type (data_variant));
+
+    gsize          n_dims = 0;
+    const guint64 *shape = static_cast <const guint64 *> (g_variant_get_fixed_array (shape_variant,
+                                                                                      &n_dims,
+                                                                                      sizeof (guint64)));
+    std::vector <int64_t> dimensions (shape, shape + n_dims);
+
+    const size_t   element_size = flat_g_variant_element_size (scalar_type);
+    gsize          n_elements = 0;
+    gconstpointer  elements = g_variant_get_fixed_array (data_variant, &n_elements, element_size);
+
+    torch::Tensor tensor = torch::empty (
+      torch::IntArrayRef (dimensions),
+      torch::TensorOptions ().dtype (scalar_type).device (torch::kCPU)
+    );
+
+    if (n_elements * element_size != tensor.nbytes ())
+      throw InvalidShapeError ("Size of the data does not match the shape");
+
+    if (n_elements > 0)
+      memcpy (tensor.data_ptr (), elements, n_elements * element_size);
+
+    return tensor;
+  }
+
+  torch::Tensor new_tensor_from_gvariant (GVariant *variant)
+  {
+    if (g_variant_is_of_type (variant, G_VARIANT_TYPE_VARIANT))
+      {
+        g_autoptr (GVariant) v = g_variant_get_variant (variant);
+        return new_tensor_from_gvariant (v);
+      }
+
+    if (is_flat_tensor_variant (variant))
+      return new_tensor_from_flat_gvariant (variant);
+
+    return new_tensor_from_nested_gvariants (variant);
+  }
 }
 
 torch::Tensor &
@@ -438,7 +867,7 @@ torch_tensor_get_real_tensor (TorchTensor *tensor)
   if (!torch_tensor_init_internal (tensor, static_cast <GError **> (&error)))
     torch_throw_error (error);
 
-  return *priv->internal;
+  return priv->internal;
 }
 
 gboolean
@@ -451,7 +880,7 @@ torch_tensor_init_internal (TorchTensor  *tensor,
 
   /* Even though we have a check in torch_tensor_initable_init,
    * check again here to avoid the vfunc calls */
-  if (!priv->internal)
+  if (!priv->has_internal)
     return g_initable_init (G_INITABLE (tensor), NULL, error);
 
   return TRUE;
@@ -502,7 +931,7 @@ torch_tensor_index_array (TorchTensor  *tensor,
     return NULL;
 
   return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> TorchTensor * {
-    torch::Tensor &internal = *priv->internal;
+    torch::Tensor &internal = priv->internal;
     auto tensor_indices = torch_index_g_ptr_array_to_tensor_indices (indices);
 
     return torch_tensor_new_from_real_tensor (internal.index (tensor_indices));
@@ -564,7 +993,7 @@ torch_tensor_index_array_put_inplace (TorchTensor  *tensor,
     return NULL;
 
   return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> TorchTensor * {
-    torch::Tensor &internal = *priv->internal;
+    torch::Tensor &internal = priv->internal;
     auto &unwrapped = UnwrapType <Type>::unwrap (value);
     auto tensor_indices = torch_index_g_ptr_array_to_tensor_indices (indices);
 
@@ -888,11 +1317,85 @@ torch_tensor_copy_to_device (TorchTensor  *tensor,
 
   return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> TorchTensor * {
     return torch_tensor_new_from_real_tensor (
-      priv->internal->to(torch::TensorOptions {torch::Device {torch::kVulkan}})
+      priv->internal.to (torch_device_get_real_device (device))
     );
   });
 }
 
+/**
+ * torch_tensor_copy_to_device_async:
+ * @tensor: (transfer none): A #TorchTensor
+ * @device: (transfer none): A #TorchDevice
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: (scope async): A #GAsyncReadyCallback to call when the copy is done
+ * @user_data: Closure data for @callback
+ *
+ * Asynchronously copy @tensor to a new storage on @device, like
+ * %torch_tensor_copy_to_device. The copy runs on the torch-gobject
+ * worker threads, so that copies of large tensors do not block the
+ * main loop. Call %torch_tensor_copy_to_device_finish from @callback
+ * to get the result.
+ */
+void
+torch_tensor_copy_to_device_async (TorchTensor         *tensor,
+                                   TorchDevice         *device,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
+  g_autoptr (GError)  error = NULL;
+
+  g_return_if_fail (TORCH_IS_TENSOR (tensor));
+  g_return_if_fail (TORCH_IS_DEVICE (device));
+
+  if (!torch_tensor_init_internal (tensor, &error))
+    {
+      g_task_report_error (tensor,
+                           callback,
+                           user_data,
+                           reinterpret_cast <gpointer> (torch_tensor_copy_to_device_async),
+                           static_cast <GError *> (g_steal_pointer (&error)));
+      return;
+    }
+
+  /* Both are copied into the closure, the copy itself happens
+   * on the worker thread */
+  torch::Tensor real_tensor = priv->internal;
+  c10::Device   real_device = torch_device_get_real_device (device);
+
+  torch_tensor_run_task_in_worker_thread (tensor,
+                                          cancellable,
+                                          callback,
+                                          user_data,
+                                          reinterpret_cast <gpointer> (torch_tensor_copy_to_device_async),
+                                          [real_tensor, real_device]() -> at::Tensor {
+    return real_tensor.to (real_device);
+  });
+}
+
+/**
+ * torch_tensor_copy_to_device_finish:
+ * @tensor: (transfer none): A #TorchTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Finish an operation started with %torch_tensor_copy_to_device_async.
+ *
+ * Returns: (transfer full): A new #TorchTensor with the contents of @tensor on
+ *                           the requested device or %NULL with @error set on failure.
+ */
+TorchTensor *
+torch_tensor_copy_to_device_finish (TorchTensor   *tensor,
+                                    GAsyncResult  *result,
+                                    GError       **error)
+{
+  return torch_tensor_task_finish (result,
+                                   tensor,
+                                   reinterpret_cast <gpointer> (torch_tensor_copy_to_device_async),
+                                   error);
+}
+
 /**
  * torch_tensor_copy_to_cpu:
  * @tensor: (transfer none): A #TorchTensor
@@ -916,7 +1419,7 @@ torch_tensor_copy_to_cpu (TorchTensor  *tensor,
 
   return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> TorchTensor * {
     return torch_tensor_new_from_real_tensor (
-      priv->internal->cpu ()
+      priv->internal.cpu ()
     );
   });
 }
@@ -944,9 +1447,12 @@ torch_tensor_get_dims (TorchTensor  *tensor,
   TorchTensorPrivate *priv =
     static_cast <TorchTensorPrivate *> (torch_tensor_get_instance_private (tensor));
 
+  if (!torch_tensor_init_internal (tensor, error))
+    return NULL;
+
   try
     {
-      return g_list_from_int_list <unsigned int> (priv->internal->sizes ());
+      return g_list_from_int_list <unsigned int> (priv->internal.sizes ());
     }
   catch (std::exception const &e)
     {
@@ -991,19 +1497,12 @@ torch_tensor_set_dims (TorchTensor  *tensor,
   TorchTensorPrivate *priv =
     static_cast <TorchTensorPrivate *> (torch_tensor_get_instance_private (tensor));
 
-  if (!priv->is_constructed)
-    {
-      g_clear_pointer (&priv->construction_dims, g_list_free);
-      priv->construction_dims = dims != NULL ? g_list_copy (dims) : NULL;
-      return TRUE;
-    }
-
   if (!torch_tensor_init_internal (tensor, error))
     return FALSE;
 
   try
     {
-      priv->internal->resize_ (torch::IntArrayRef (int_list_from_g_list <unsigned int> (dims)));
+      priv->internal.resize_ (torch::IntArrayRef (int_list_from_g_list <unsigned int> (dims)));
     }
   catch (std::exception const &e)
     {
@@ -1024,12 +1523,19 @@ torch_tensor_set_dims (TorchTensor  *tensor,
  * Return the underlying data for a tensor as an array of variants
  * (av), where each variant in the array is itself an array
  * array of variants or an array of a particular datatype
- * (d|x|f).
+ * (b|y|n|i|x|d).
+ *
+ * Data types which GVariant cannot represent natively, such
+ * as float32 and float16, are stored in the innermost arrays as a
+ * "(say)" tuple of the data type name (for instance "float32") and
+ * the raw bytes of the elements in native byte order. A tensor with
+ * no dimensions is returned as a single value of the basic type, or in
+ * the flat format of %torch_tensor_get_flat_variant if there is none.
  *
  * The level of nesting of array-variants corresponds to
  * the number of dimensions in the tensor. For instance, a 2D
- * tensor will have an array of arrays of (d|x|f). It is the programmer's
- * responsibility to ensure that the returned variant is decoded
+ * tensor will have an array of arrays of (b|y|n|i|x|d). It is
+ * the programmer's responsibility to ensure that the returned variant is decoded
  * properly, both in terms of its nesting and its underlying
  * datatype.
  *
@@ -1054,15 +1560,126 @@ torch_tensor_get_tensor_data (TorchTensor  *tensor,
 
   try
     {
-      return serialize_tensor_data_to_nested_gvariants (*priv->internal);
+      return serialize_tensor_data_to_nested_gvariants (priv->internal);
+    }
+  catch (InvalidDataTypeError const &e)
+    {
+      return reinterpret_cast <GVariant *> (set_error_from_exception (e,
+                                                                      TORCH_ERROR,
+                                                                      TORCH_ERROR_INVALID_DATA_TYPE,
+                                                                      error));
+    }
+}
+
+/**
+ * torch_tensor_get_flat_variant:
+ * @tensor: A tensor to get the data for.
+ * @error: A #GError
+ *
+ * Return the underlying data for a tensor as a flat "(sat*)"
+ * tuple, where the first member is the name of the data type
+ * of the tensor (for instance "float64" or "uint8"), the second
+ * member is the shape of the tensor and the third member is a
+ * single array containing all the elements of the tensor in
+ * row-major order.
+ *
+ * Data types which GVariant can represent natively are stored
+ * as arrays of that type, other data types are stored as an
+ * array of bytes ("ay") in native byte order.
+ *
+ * Unlike %torch_tensor_get_tensor_data, the variant is built with
+ * a single allocation, so this is the preferred format for moving
+ * large tensors over D-Bus or storing them in GSettings. The
+ * returned variant can be passed to %torch_tensor_set_data or
+ * the #TorchTensor:data property to reconstruct the tensor.
+ *
+ * Returns: (transfer none): A floating reference to a new
+ *          #GVariant containing the tensor data
+ *          or %NULL with @error set on failure.
+ */
+GVariant *
+torch_tensor_get_flat_variant (TorchTensor  *tensor,
+                               GError      **error)
+{
+  TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
+
+  if (!torch_tensor_init_internal (tensor, error))
+    return NULL;
+
+  try
+    {
+      return serialize_tensor_data_to_flat_gvariant (priv->internal);
     }
-  catch (InvalidScalarTypeError const &e)
+  catch (InvalidDataTypeError const &e)
     {
       return reinterpret_cast <GVariant *> (set_error_from_exception (e,
                                                                       TORCH_ERROR,
                                                                       TORCH_ERROR_INVALID_DATA_TYPE,
                                                                       error));
     }
+  catch (std::exception const &e)
+    {
+      return reinterpret_cast <GVariant *> (set_error_from_exception (e,
+                                                                      G_IO_ERROR,
+                                                                      G_IO_ERROR_FAILED,
+                                                                      error));
+    }
+}
+
+/**
+ * torch_tensor_get_data_bytes:
+ * @tensor: A tensor to get the data for.
+ * @error: A #GError
+ *
+ * Return a #GBytes which refers directly to the memory backing
+ * @tensor, without copying or converting it. The elements are laid
+ * out in row-major order in native byte order, in the data type
+ * returned by %torch_tensor_get_dtype. The returned #GBytes holds a
+ * reference to the underlying storage, so it remains valid after
+ * @tensor is destroyed.
+ *
+ * The memory is shared with @tensor, so in-place operations on
+ * @tensor are visible through the returned #GBytes. The tensor
+ * must not be resized while the #GBytes is alive.
+ *
+ * Only contiguous tensors on the CPU are supported. For other tensors,
+ * and for tensors with no data, %G_IO_ERROR_NOT_SUPPORTED is returned;
+ * use %torch_tensor_get_flat_variant to get a copy of their data instead.
+ *
+ * Returns: (transfer full): A #GBytes referring to the tensor data
+ *          or %NULL with @error set on failure.
+ */
+GBytes *
+torch_tensor_get_data_bytes (TorchTensor  *tensor,
+                             GError      **error)
+{
+  TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
+
+  if (!torch_tensor_init_internal (tensor, error))
+    return NULL;
+
+  torch::Tensor &internal = priv->internal;
+
+  if (!internal.defined () ||
+      !internal.device ().is_cpu () ||
+      internal.layout () != torch::kStrided ||
+      !internal.is_contiguous ())
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "Only contiguous CPU tensors can be viewed as bytes");
+      return NULL;
+    }
+
+  return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, NULL, [&]() -> GBytes * {
+    /* The copy of the storage keeps the StorageImpl alive until
+     * the GBytes is released. */
+    return g_bytes_new_with_free_func (internal.data_ptr (),
+                                       internal.nbytes (),
+                                       (GDestroyNotify) safe_delete <c10::Storage>,
+                                       new c10::Storage (internal.storage ()));
+  });
 }
 
 /**
@@ -1070,14 +1687,15 @@ torch_tensor_get_tensor_data (TorchTensor  *tensor,
  * @tensor: A tensor to set the data on
  * @data: (transfer none): A #GVariant of type "av" containing
  *        an array of variants according to the schema
- *        specified in %torch_tensor_get_data.
+ *        specified in %torch_tensor_get_tensor_data, or a flat
+ *        tuple as returned by %torch_tensor_get_flat_variant.
  *
  * The tensor will be automatically resized and adopt
- * the dimensionality of the nested array of variants. It
- * is the programmer's responsibility to ensure that
- * sub-array sizes are consistent between sub-arrays
- * of the same dimension and that the underlying datatype
- * is consistent between all sub-arrays.
+ * the dimensionality of the nested array of variants. Sub-array
+ * sizes must be consistent between sub-arrays of the same
+ * dimension and the underlying datatype must be consistent
+ * between all sub-arrays, otherwise %TORCH_ERROR_INVALID_SHAPE
+ * or %TORCH_ERROR_INVALID_DATA_TYPE is returned.
  *
  * PyTorch will likely copy the contents of the array
  * either into CPU memory or GPU memory as a result of
@@ -1097,27 +1715,27 @@ torch_tensor_set_data (TorchTensor  *tensor,
   if (data == nullptr)
     return TRUE;
 
-  if (!priv->is_constructed)
-    {
-      g_clear_pointer (&priv->construction_data, g_variant_unref);
-      priv->construction_data = g_variant_ref (data);
-      return TRUE;
-    }
-
   if (!torch_tensor_init_internal (tensor, error))
     return FALSE;
 
   try
     {
-      priv->internal->set_data (new_tensor_from_nested_gvariants (data));
+      priv->internal.set_data (new_tensor_from_gvariant (data));
     }
-  catch (InvalidVariantTypeError &e)
+  catch (InvalidDataTypeError const &e)
     {
       return (gboolean) (set_error_from_exception (e,
                                                    TORCH_ERROR,
                                                    TORCH_ERROR_INVALID_DATA_TYPE,
                                                    error));
     }
+  catch (InvalidShapeError const &e)
+    {
+      return (gboolean) (set_error_from_exception (e,
+                                                   TORCH_ERROR,
+                                                   TORCH_ERROR_INVALID_SHAPE,
+                                                   error));
+    }
   catch (std::exception const &e)
     {
       return (gboolean) (set_error_from_exception (e,
@@ -1134,7 +1752,9 @@ torch_tensor_set_data (TorchTensor  *tensor,
  * @tensor: (transfer none): A #TorchTensor
  * @error: A #GError
  *
- * Get the data type of a TorchTensor
+ * Get the data type of a TorchTensor. Data types with no matching
+ * #GType, such as int16, float16 and bfloat16, are reported as
+ * an error.
  *
  * Returns: A #GType with the internal data type of this tensor,
  *          0 on failure with @error set.
@@ -1148,7 +1768,9 @@ torch_tensor_get_dtype (TorchTensor  *tensor,
   if (!torch_tensor_init_internal (tensor, error))
     return static_cast <GType> (0);
 
-  return torch_gtype_from_scalar_type (priv->internal->scalar_type ());
+  return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, static_cast <GType> (0), [&]() -> GType {
+    return torch_gtype_from_scalar_type (priv->internal.scalar_type ());
+  });
 }
 
 static gboolean
@@ -1160,13 +1782,14 @@ torch_tensor_initable_init (GInitable     *initable,
   TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
 
   /* Already initialized, skip */
-  if (priv->internal)
+  if (priv->has_internal)
     return TRUE;
 
   return call_set_error_on_exception (error, G_IO_ERROR, G_IO_ERROR_FAILED, FALSE, [&]() -> gboolean {
     if (priv->construction_data)
       {
-        priv->internal = new torch::Tensor (new_tensor_from_nested_gvariants (priv->construction_data));
+        priv->internal = new_tensor_from_gvariant (priv->construction_data);
+        priv->has_internal = TRUE;
 
         if (priv->construction_dims)
           {
@@ -1176,7 +1799,8 @@ torch_tensor_initable_init (GInitable     *initable,
       }
     else
       {
-        priv->internal = new torch::Tensor ();
+        /* Keep the undefined tensor from torch_tensor_init */
+        priv->has_internal = TRUE;
       }
 
     /* Once we've constructed the internal, everything gets moved to
@@ -1184,7 +1808,6 @@ torch_tensor_initable_init (GInitable     *initable,
      * properties that we had in the meantime */
     g_clear_pointer (&priv->construction_dims, g_list_free);
     g_clear_pointer (&priv->construction_data, g_variant_unref);
-    priv->is_constructed = TRUE;
     return TRUE;
   });
 }
@@ -1199,7 +1822,11 @@ static void
 torch_tensor_init (TorchTensor *tensor)
 {
   TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
-  priv->is_constructed = FALSE;
+
+  /* The private struct is zero-filled, which is not a valid
+   * torch::Tensor, so construct it in place */
+  new (&priv->internal) torch::Tensor ();
+  priv->has_internal = FALSE;
 }
 
 static void
@@ -1208,23 +1835,12 @@ torch_tensor_finalize (GObject *object)
   TorchTensor *tensor = TORCH_TENSOR (object);
   TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
 
-  if (priv->internal)
-    {
-      delete priv->internal;
-      priv->internal = nullptr;
-    }
+  priv->internal.~Tensor ();
 
   g_clear_pointer (&priv->construction_dims, g_list_free);
   g_clear_pointer (&priv->construction_data, g_variant_unref);
-}
 
-static void
-torch_tensor_constructed (GObject *object)
-{
-  TorchTensor        *tensor = TORCH_TENSOR (object);
-  TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
-
-  priv->is_constructed = TRUE;
+  G_OBJECT_CLASS (torch_tensor_parent_class)->finalize (object);
 }
 
 static void
@@ -1269,8 +1885,33 @@ torch_tensor_set_property (GObject      *object,
                             GParamSpec   *pspec)
 {
   TorchTensor *tensor = TORCH_TENSOR (object);
+  TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
+
+  /* The properties are not construct properties, so that
+   * g_object_new can skip the property machinery for tensors
+   * created without them. Until the tensor is first used, they are
+   * kept to be applied by torch_tensor_initable_init, which reports
+   * any errors. The public setters always apply them right away. */
+  if (!priv->has_internal)
+    {
+      switch (prop_id)
+        {
+          case PROP_DIMS:
+            g_clear_pointer (&priv->construction_dims, g_list_free);
+            priv->construction_dims = g_list_copy (static_cast <GList *> (g_value_get_boxed (value)));
+            return;
+          case PROP_DATA:
+            if (g_value_get_variant (value) != NULL)
+              {
+                g_clear_pointer (&priv->construction_data, g_variant_unref);
+                priv->construction_data = g_value_dup_variant (value);
+              }
+            return;
+          default:
+            break;
+        }
+    }
 
-  /* Properties only get set on construction */
   switch (prop_id)
     {
       case PROP_DIMS:
@@ -1313,7 +1954,6 @@ torch_tensor_class_init (TorchTensorClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
-  object_class->constructed = torch_tensor_constructed;
   object_class->get_property = torch_tensor_get_property;
   object_class->set_property = torch_tensor_set_property;
   object_class->finalize = torch_tensor_finalize;
@@ -1331,14 +1971,15 @@ torch_tensor_class_init (TorchTensorClass *klass)
                                                       "Dimensions",
                                                       "Dimensions of the Tensor",
                                                       G_TYPE_LIST,
-                                                      static_cast <GParamFlags> (G_PARAM_READWRITE |
-                                                                                 G_PARAM_CONSTRUCT));
+                                                      static_cast <GParamFlags> (G_PARAM_READWRITE));
 
   /**
    * TorchTensor:data: (transfer full)
    *
    * The data of the tensor as a nested array of arrays of variants,
-   * with the leaf variants being arrays of concrete types.
+   * with the leaf variants being arrays of concrete types. When set,
+   * the flat format returned by %torch_tensor_get_flat_variant is
+   * also accepted.
    *
    * When set, the tensor will be automatically resized and adopt
    * the dimensionality of the nested array of variants. It
@@ -1360,8 +2001,7 @@ torch_tensor_class_init (TorchTensorClass *klass)
                                                         "Data of the Tensor",
                                                         G_VARIANT_TYPE ("v"),
                                                         nullptr,
-                                                        static_cast <GParamFlags> (G_PARAM_READWRITE |
-                                                                                   G_PARAM_CONSTRUCT));
+                                                        static_cast <GParamFlags> (G_PARAM_READWRITE));
 
   /**
    * TorchTensor:dtype:
@@ -1391,14 +2031,174 @@ torch_tensor_new_from_data (GVariant *data)
   return static_cast <TorchTensor *> (g_object_new (TORCH_TYPE_TENSOR, "data", data, NULL));
 }
 
+/**
+ * torch_tensor_new_from_bytes:
+ * @data: (transfer none): A #GBytes containing the tensor elements.
+ * @dtype: A #GType describing the type of each element in @data.
+ * @sizes: (element-type gint64): A #GArray with the size of each dimension.
+ * @strides: (element-type gint64) (nullable): A #GArray with the stride of
+ *           each dimension, in elements, or %NULL if @data is laid out
+ *           contiguously.
+ * @error: A #GError
+ *
+ * Create a new #TorchTensor that is a view over the memory in @data,
+ * without copying it. The tensor keeps a reference on @data for as long
+ * as its storage is alive, so construction takes constant time regardless
+ * of the size of @data.
+ *
+ * Since #GBytes is immutable, in-place operations must not be used on the
+ * returned tensor or any views of it. Clone the tensor first if it needs
+ * to be modified.
+ *
+ * Returns: (transfer full): A new #TorchTensor viewing @data or %NULL
+ *                           with @error set on failure.
+ */
+TorchTensor *
+torch_tensor_new_from_bytes (GBytes  *data,
+                             GType    dtype,
+                             GArray  *sizes,
+                             GArray  *strides,
+                             GError **error)
+{
+  g_return_val_if_fail (data != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  try
+    {
+      c10::ScalarType       scalar_type = torch_scalar_type_from_gtype (dtype);
+      std::vector <int64_t> sizes_vec = int_list_from_g_array <gint64> (sizes);
+      std::vector <int64_t> strides_vec = strides != NULL ?
+                                          int_list_from_g_array <gint64> (strides) :
+                                          contiguous_strides_for_sizes (sizes_vec);
+      gsize                 n_bytes = 0;
+      gconstpointer         bytes_data = g_bytes_get_data (data, &n_bytes);
+
+      if (storage_bytes_for_layout (sizes_vec, strides_vec, c10::elementSize (scalar_type)) > n_bytes)
+        throw InvalidShapeError ("Sizes and strides exceed the size of the data");
+
+      /* The deleter takes over this reference once the tensor is created */
+      g_autoptr (GBytes) data_ref = g_bytes_ref (data);
+      GBytes *deleter_data_ref = data_ref;
+
+      torch::Tensor real_tensor = torch::from_blob (const_cast <gpointer> (bytes_data),
+                                                    torch::IntArrayRef (sizes_vec),
+                                                    torch::IntArrayRef (strides_vec),
+                                                    [deleter_data_ref](void *) {
+                                                      g_bytes_unref (deleter_data_ref);
+                                                    },
+                                                    torch::TensorOptions ().dtype (scalar_type));
+      g_steal_pointer (&data_ref);
+
+      return torch_tensor_new_from_real_tensor (real_tensor);
+    }
+  catch (InvalidShapeError const &e)
+    {
+      return reinterpret_cast <TorchTensor *> (set_error_from_exception (e,
+                                                                         TORCH_ERROR,
+                                                                         TORCH_ERROR_INVALID_SHAPE,
+                                                                         error));
+    }
+  catch (std::exception const &e)
+    {
+      return reinterpret_cast <TorchTensor *> (set_error_from_exception (e,
+                                                                         G_IO_ERROR,
+                                                                         G_IO_ERROR_FAILED,
+                                                                         error));
+    }
+}
+
+/**
+ * torch_tensor_new_from_storage:
+ * @storage: (transfer none): A #TorchStorage to view.
+ * @storage_offset: The offset of the first element of the tensor
+ *                  in @storage, in elements.
+ * @sizes: (element-type gint64): A #GArray with the size of each dimension.
+ * @strides: (element-type gint64) (nullable): A #GArray with the stride of
+ *           each dimension, in elements, or %NULL if the tensor is laid out
+ *           contiguously.
+ * @dtype: A #GType describing the type of each element in @storage.
+ * @error: A #GError
+ *
+ * Create a new #TorchTensor that is a view over the memory in @storage,
+ * without copying it. Many tensors can be created over the same storage,
+ * for instance to carve packed weights or the slots of a ring buffer out
+ * of one preallocated block of memory. Writes through any of those tensors
+ * are visible through all the others.
+ *
+ * The elements addressed by @storage_offset, @sizes and @strides must
+ * lie within @storage, otherwise %TORCH_ERROR_INVALID_SHAPE is returned.
+ *
+ * Returns: (transfer full): A new #TorchTensor viewing @storage or %NULL
+ *                           with @error set on failure.
+ */
+TorchTensor *
+torch_tensor_new_from_storage (TorchStorage  *storage,
+                               gsize          storage_offset,
+                               GArray        *sizes,
+                               GArray        *strides,
+                               GType          dtype,
+                               GError       **error)
+{
+  g_return_val_if_fail (TORCH_IS_STORAGE (storage), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!torch_storage_init_internal (storage, error))
+    return NULL;
+
+  try
+    {
+      c10::Storage         &real_storage = torch_storage_get_real_storage (storage);
+      c10::ScalarType       scalar_type = torch_scalar_type_from_gtype (dtype);
+      const size_t          element_size = c10::elementSize (scalar_type);
+      std::vector <int64_t> sizes_vec = int_list_from_g_array <gint64> (sizes);
+      std::vector <int64_t> strides_vec = strides != NULL ?
+                                          int_list_from_g_array <gint64> (strides) :
+                                          contiguous_strides_for_sizes (sizes_vec);
+      const size_t          n_bytes = storage_bytes_for_layout (sizes_vec, strides_vec, element_size);
+
+      if (n_bytes > 0 && storage_offset * element_size + n_bytes > real_storage.nbytes ())
+        throw InvalidShapeError ("Offset, sizes and strides exceed the size of the storage");
+
+      torch::Tensor real_tensor = torch::empty (
+        {0},
+        torch::TensorOptions ().dtype (scalar_type).device (real_storage.device ())
+      );
+      real_tensor.set_ (real_storage,
+                        storage_offset,
+                        torch::IntArrayRef (sizes_vec),
+                        torch::IntArrayRef (strides_vec));
+
+      return torch_tensor_new_from_real_tensor (real_tensor);
+    }
+  catch (InvalidShapeError const &e)
+    {
+      return reinterpret_cast <TorchTensor *> (set_error_from_exception (e,
+                                                                         TORCH_ERROR,
+                                                                         TORCH_ERROR_INVALID_SHAPE,
+                                                                         error));
+    }
+  catch (std::exception const &e)
+    {
+      return reinterpret_cast <TorchTensor *> (set_error_from_exception (e,
+                                                                         G_IO_ERROR,
+                                                                         G_IO_ERROR_FAILED,
+                                                                         error));
+    }
+}
+
+/* This is the path taken by every generated wrapper that returns
+ * a tensor, so it is kept cheap: TorchTensor has no construct
+ * properties and no constructed vfunc, which lets g_object_new skip
+ * the property and notification machinery, and the initable step is
+ * skipped by setting the internal tensor directly. */
 TorchTensor *
 torch_tensor_new_from_real_tensor (torch::Tensor const &real_tensor)
 {
   g_autoptr (TorchTensor) tensor = static_cast <TorchTensor *> (g_object_new (TORCH_TYPE_TENSOR, NULL));
   TorchTensorPrivate *priv = TORCH_TENSOR_GET_PRIVATE (tensor);
 
-  priv->internal = new torch::Tensor (real_tensor);
-  priv->is_constructed = TRUE;
+  priv->internal = real_tensor;
+  priv->has_internal = TRUE;
 
   return static_cast <TorchTensor *> (g_steal_pointer (&tensor));
 }
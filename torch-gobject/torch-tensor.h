@@ -24,8 +24,10 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include <torch-gobject/torch-device.h>
+#include <torch-gobject/torch-storage.h>
 #include <torch-gobject/torch-tensor-index.h>
 
 G_BEGIN_DECLS
@@ -37,6 +39,19 @@ TorchTensor * torch_tensor_new (void);
 
 TorchTensor * torch_tensor_new_from_data (GVariant *data);
 
+TorchTensor * torch_tensor_new_from_bytes (GBytes  *data,
+                                           GType    dtype,
+                                           GArray  *sizes,
+                                           GArray  *strides,
+                                           GError **error);
+
+TorchTensor * torch_tensor_new_from_storage (TorchStorage  *storage,
+                                             gsize          storage_offset,
+                                             GArray        *sizes,
+                                             GArray        *strides,
+                                             GType          dtype,
+                                             GError       **error);
+
 TorchTensor * torch_tensor_index_array (TorchTensor  *tensor,
                                         GPtrArray    *indices,
                                         GError      **error);
@@ -98,6 +113,16 @@ TorchTensor * torch_tensor_copy_to_device (TorchTensor  *tensor,
                                            TorchDevice  *device,
                                            GError      **error);
 
+void torch_tensor_copy_to_device_async (TorchTensor         *tensor,
+                                        TorchDevice         *device,
+                                        GCancellable        *cancellable,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data);
+
+TorchTensor * torch_tensor_copy_to_device_finish (TorchTensor   *tensor,
+                                                  GAsyncResult  *result,
+                                                  GError       **error);
+
 TorchTensor * torch_tensor_copy_to_cpu (TorchTensor  *tensor,
                                         GError      **error);
 
@@ -107,6 +132,12 @@ GType torch_tensor_get_dtype (TorchTensor  *tensor,
 GVariant * torch_tensor_get_tensor_data (TorchTensor  *tensor,
                                          GError      **error);
 
+GVariant * torch_tensor_get_flat_variant (TorchTensor  *tensor,
+                                          GError      **error);
+
+GBytes * torch_tensor_get_data_bytes (TorchTensor  *tensor,
+                                      GError      **error);
+
 gboolean torch_tensor_set_data (TorchTensor  *tensor,
                                 GVariant     *data,
                                 GError      **error);
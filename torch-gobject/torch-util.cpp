@@ -96,6 +96,15 @@ GType torch_gtype_from_scalar_type (c10::ScalarType const &scalar_type)
         return G_TYPE_FLOAT;
       case c10::ScalarType::Double:
         return G_TYPE_DOUBLE;
+      case c10::ScalarType::Byte:
+        return G_TYPE_UCHAR;
+      case c10::ScalarType::Char:
+        return G_TYPE_CHAR;
+      /* GLib has no 16 bit integer type, and reporting int16 as
+       * G_TYPE_INT would not round-trip, so int16 is unsupported
+       * here like float16 */
+      case c10::ScalarType::Int:
+        return G_TYPE_INT;
       case c10::ScalarType::Long:
         return G_TYPE_LONG;
       case c10::ScalarType::Bool:
@@ -113,7 +122,12 @@ c10::ScalarType torch_scalar_type_from_gtype (GType type)
         return c10::ScalarType::Float;
       case G_TYPE_DOUBLE:
         return c10::ScalarType::Double;
+      case G_TYPE_UCHAR:
+        return c10::ScalarType::Byte;
+      case G_TYPE_CHAR:
+        return c10::ScalarType::Char;
       case G_TYPE_INT:
+        return c10::ScalarType::Int;
       case G_TYPE_LONG:
       case G_TYPE_INT64:
       case G_TYPE_NONE:
@@ -129,7 +143,7 @@ namespace {
   template <typename InternalType, typename ConversionFunc>
   GPtrArray * object_ptr_array_from_object_array_ref (c10::ArrayRef<InternalType> const &array, ConversionFunc &&conv)
   {
-    g_autoptr (GPtrArray) ptr_array = g_ptr_array_new_with_free_func (g_object_unref);
+    g_autoptr (GPtrArray) ptr_array = g_ptr_array_new_full (array.size (), g_object_unref);
 
     for (auto const &object: array)
       g_ptr_array_add (ptr_array, conv (object));
@@ -137,13 +151,14 @@ namespace {
     return static_cast <GPtrArray *> (g_steal_pointer (&ptr_array));
   }
 
-  template <typename InternalType, typename LibraryType, typename ConversionFunc>
-  std::vector<InternalType> object_vector_from_object_ptr_array (GPtrArray *ptr_array, ConversionFunc &&conv)
+  template <typename Container, typename LibraryType, typename ConversionFunc>
+  Container object_container_from_object_ptr_array (GPtrArray *ptr_array, ConversionFunc &&conv)
   {
-    std::vector <InternalType> array;
+    Container array;
+    array.reserve (ptr_array->len);
 
     for (size_t i = 0; i < ptr_array->len; ++i)
-      array.push_back(conv (static_cast <LibraryType> (g_ptr_array_index (ptr_array, i))));
+      array.emplace_back (conv (static_cast <LibraryType> (g_ptr_array_index (ptr_array, i))));
 
     return array;
   }
@@ -154,14 +169,14 @@ GPtrArray * torch_tensor_ptr_array_from_tensor_list (at::TensorList const &list)
   return object_ptr_array_from_object_array_ref (list, torch_tensor_new_from_real_tensor);
 }
 
-std::vector <at::Tensor> torch_tensor_list_from_tensor_ptr_array (GPtrArray *array)
+c10::SmallVector <at::Tensor, torch_small_list_size> torch_tensor_list_from_tensor_ptr_array (GPtrArray *array)
 {
-  return object_vector_from_object_ptr_array <at::Tensor, TorchTensor *> (array, torch_tensor_get_real_tensor);
+  return object_container_from_object_ptr_array <c10::SmallVector <at::Tensor, torch_small_list_size>, TorchTensor *> (array, torch_tensor_get_real_tensor);
 }
 
 GPtrArray * torch_tensor_ptr_array_from_optional_tensor_list (c10::List <c10::optional <at::Tensor> > const &list)
 {
-  g_autoptr (GPtrArray) ptr_array = g_ptr_array_new_with_free_func (g_object_unref);
+  g_autoptr (GPtrArray) ptr_array = g_ptr_array_new_full (list.size (), g_object_unref);
 
   for (c10::optional <at::Tensor> const &optional_tensor: list)
     g_ptr_array_add (ptr_array,
@@ -176,6 +191,7 @@ GPtrArray * torch_tensor_ptr_array_from_optional_tensor_list (c10::List <c10::op
 c10::List <c10::optional <at::Tensor> > torch_optional_tensor_list_from_tensor_ptr_array (GPtrArray *ptr_array)
 {
   c10::List <c10::optional <at::Tensor> > list;
+  list.reserve (ptr_array->len);
 
   for (size_t i = 0; i < ptr_array->len; ++i)
     {
@@ -195,7 +211,7 @@ GPtrArray * torch_dimname_ptr_array_from_dimname_list (at::DimnameList const &li
   return object_ptr_array_from_object_array_ref (list, torch_dimname_new_from_real_dimname);
 }
 
-std::vector <at::Dimname> torch_dimname_list_from_dimname_ptr_array (GPtrArray *array)
+c10::SmallVector <at::Dimname, torch_small_list_size> torch_dimname_list_from_dimname_ptr_array (GPtrArray *array)
 {
-  return object_vector_from_object_ptr_array <at::Dimname, TorchDimname *> (array, torch_dimname_get_real_dimname);
+  return object_container_from_object_ptr_array <c10::SmallVector <at::Dimname, torch_small_list_size>, TorchDimname *> (array, torch_dimname_get_real_dimname);
 }
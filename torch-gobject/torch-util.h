@@ -29,6 +29,7 @@
 #include <glib-object.h>
 
 #include <c10/util/ArrayRef.h>
+#include <c10/util/SmallVector.h>
 #include <c10/core/Scalar.h>
 #include <ATen/core/ivalue.h>
 #include <ATen/Dimname.h>
@@ -111,7 +112,7 @@ namespace
     template <typename InternalType, typename ConversionFunc>
     GPtrArray * object_ptr_array_from_object_array_ref (c10::ArrayRef<InternalType> const &array, ConversionFunc &&conv)
     {
-      g_autoptr (GPtrArray) ptr_array = g_ptr_array_new_with_free_func (g_object_unref);
+      g_autoptr (GPtrArray) ptr_array = g_ptr_array_new_full (array.size (), g_object_unref);
 
       for (auto const &object: array)
         g_ptr_array_add (ptr_array, conv (object));
@@ -123,6 +124,7 @@ namespace
     std::vector<InternalType> object_vector_from_object_ptr_array (GPtrArray *ptr_array, ConversionFunc &&conv)
     {
       std::vector <InternalType> array;
+      array.reserve (ptr_array->len);
 
       for (size_t i = 0; i < ptr_array->len; ++i)
         array.push_back(conv (static_cast <LibraryType> (g_ptr_array_index (ptr_array, i))));
@@ -294,6 +296,25 @@ namespace
     return static_cast <GPtrArray *> (g_steal_pointer (&ptr_array));
   }
 
+  /* XXX: Its not entirely clear to me why,
+   *      but if we return an IntArrayRef here, we crash
+   *      because at::List doesn't make a copy of the underlying
+   *      memory, and the constructor does not take an rvalue
+   *      reference, so the move never happens. */
+  template <typename Source>
+  std::vector<int64_t> int_list_from_g_array (GArray *array)
+  {
+    std::vector <int64_t> vec;
+    size_t n_elements = array != NULL ? array->len : 0;
+    const Source *array_data = array != NULL ? reinterpret_cast <Source *> (array->data) : NULL;
+    vec.reserve (n_elements);
+
+    for (size_t i = 0; i < n_elements; ++i)
+      vec.push_back (array_data[i]);
+
+    return vec;
+  }
+
   template <typename ErrorEnum>
   unsigned int set_error_from_exception (std::exception const  &exception,
                                          GQuark                 domain,
@@ -359,7 +380,14 @@ c10::ScalarType torch_scalar_type_from_gtype (GType type);
 
 GPtrArray * torch_tensor_ptr_array_from_tensor_list (at::TensorList const &list);
 
-std::vector <at::Tensor> torch_tensor_list_from_tensor_ptr_array (GPtrArray *array);
+/* Tensor and dimname lists passed to ATen functions are nearly always
+ * short, so the converted elements are kept inline in a SmallVector
+ * of this size to avoid a heap allocation per call. The caller must
+ * keep the returned container alive for as long as any ArrayRef
+ * view of it is in use. */
+constexpr size_t torch_small_list_size = 8;
+
+c10::SmallVector <at::Tensor, torch_small_list_size> torch_tensor_list_from_tensor_ptr_array (GPtrArray *array);
 
 GPtrArray * torch_tensor_ptr_array_from_optional_tensor_list (c10::List <c10::optional <at::Tensor> > const &list);
 
@@ -367,6 +395,6 @@ c10::List <c10::optional <at::Tensor> > torch_optional_tensor_list_from_tensor_p
 
 GPtrArray * torch_dimname_ptr_array_from_dimname_list (at::DimnameList const &list);
 
-std::vector <at::Dimname> torch_dimname_list_from_dimname_ptr_array (GPtrArray *array);
+c10::SmallVector <at::Dimname, torch_small_list_size> torch_dimname_list_from_dimname_ptr_array (GPtrArray *array);
 
 